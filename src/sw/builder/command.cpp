@@ -22,10 +22,12 @@
 #include "command.h"
 
 #include "command_storage.h"
+#include "deps_parser.h"
 #include "file.h"
 #include "file_storage.h"
 #include "jumppad.h"
 #include "os.h"
+#include "output.h"
 #include "program.h"
 #include "sw_context.h"
 
@@ -95,37 +97,18 @@ static Files process_deps_msvc(builder::Command &c)
         throw SW_RUNTIME_ERROR("msvc prefix is not set");
 
     Files deps;
-    auto perform = [&deps, &prefix](auto &text, bool out)
+    auto add = [&deps](std::string_view include)
     {
-        std::deque<String> lines;
-        boost::split(lines, text, boost::is_any_of("\n"));
-        text.clear();
-        if (out)
-        {
-            // remove filename
-            lines.pop_front();
-        }
-
-        for (auto &line : lines)
-        {
-            if (line.find(prefix) != 0)
-            {
-                text += line + "\n";
-                continue;
-            }
-            auto include = line.substr(prefix.size());
-            boost::trim(include);
-            //if (fs::exists(include)) // slow check? but correct?
-            deps.insert(include);
-        }
+        //if (fs::exists(include)) // slow check? but correct?
+        deps.insert(fs::u8path(include));
     };
 
     // on errors msvc puts everything to stderr instead of stdout
     // https://docs.microsoft.com/en-us/cpp/build/reference/showincludes-list-include-files?view=vs-2019
     // link says only stderr used for show includes
     // but we do not see it
-    perform(c.out.text, true); // remove?
-    perform(c.err.text, false);
+    parse_deps_msvc(c.out.text, prefix, true, add); // remove filename
+    parse_deps_msvc(c.err.text, prefix, false, add);
 
     return deps;
 }
@@ -140,84 +123,15 @@ static Files process_deps_gnu(builder::Command &c, const path &deps_file)
         return {};
     }
 
-    static const std::regex space_r("[^\\\\] ");
-
-    // deps file is a make in form
-    // target: dependencies
-    // deps are split by spaces on several lines with \ at the end of each line except the last one
-    //
-    // example:
-    //
-    // file.o: dep1.cpp dep2.cpp \
-            //  dep1.h dep2.h \
-    //  dep3.h \
-    //  dep4.h
-//
-
     auto f = read_file(deps_file);
 
-    // take only first output
-    // other outputs may contain same .o but for c++ modules
-    {
-        static const std::regex r{"\n\\S"};
-        std::smatch m;
-        if (std::regex_search(f, m, r)) {
-            f = m.prefix().str();
-        }
-    }
-
-    // skip target
-    //  use exactly ": " because on windows target is 'C:/path/to/file: '
-    //                                           skip up to this space ^
-    f = f.substr(f.find(": ") + 1);
-
-    FilesOrdered files;
-
-    enum
-    {
-        EMPTY,
-        FILE,
-    };
-    int state = EMPTY;
-    auto p = f.c_str();
-    auto begin = p;
-    while (*p)
-    {
-        switch (state)
-        {
-        case EMPTY:
-            if (isspace(*p) || *p == '\\')
-                break;
-            state = FILE;
-            begin = p;
-            break;
-        case FILE:
-            if (!isspace(*p))
-                break;
-            if (*(p - 1) == '\\')
-                break;
-            String s(begin, p);
-            if (!s.empty())
-            {
-                boost::replace_all(s, "\\ ", " ");
-                if (pystring::endswith(s, "\\\n")) // protobuf does not put space after filename
-                    s.resize(s.size() - 2);
-                files.push_back(fs::u8path(s));
-            }
-            state = EMPTY;
-            break;
-        }
-        p++;
-    }
-
     Files deps;
+    parse_deps_gnu(f, [&deps](std::string_view s)
+    {
 #ifndef _WIN32
-    for (auto &f : files)
-        deps.insert(f);
+        deps.insert(fs::u8path(s));
 #else
-    for (auto &f2 : files)
-    {
-        auto f3 = to_path_string(normalize_path(f2));
+        auto f3 = to_path_string(normalize_path(fs::u8path(s)));
 #ifdef CPPAN_OS_WINDOWS_NO_CYGWIN
         static const auto cyg = u8"/cygdrive/"s;
         if (f3.find(cyg) == 0)
@@ -228,8 +142,8 @@ static Files process_deps_gnu(builder::Command &c, const path &deps_file)
 #endif
         //if (!fs::exists(fs::u8path(f3)))
         deps.insert(f3);
-    }
 #endif
+    });
     return deps;
 }
 
@@ -311,30 +225,67 @@ static String getCommandId(const Command &c)
     return s;
 }
 
-bool Command::check_if_file_newer(const path &p, const String &what, bool throw_on_missing) const
+static void explainOutdated(const Command &c, ExplainReason r, const String &text,
+    const path &file = {}, const String &old_value = {}, const String &new_value = {})
 {
-    auto s = File(p, getContext().getFileStorage()).isChanged(mtime, throw_on_missing);
+    ExplainDatabase::write({ c.getHash(), r, c.getName(), file, old_value, new_value });
+    // text is big, write it only on request
+    if (sw::Settings::get_user_settings().explain_outdated_full || sw::Settings::get_user_settings().gExplainOutdatedToTrace)
+        EXPLAIN_OUTDATED("command", true, text, getCommandId(c));
+}
+
+bool Command::check_if_file_newer(const path &p, ExplainReason r, bool throw_on_missing) const
+{
+    File f(p, getContext().getFileStorage());
+    auto s = f.isChanged(mtime, throw_on_missing);
     if (s && isExplainNeeded())
-    {
-        EXPLAIN_OUTDATED("command", true, what + " changed " + to_string(p) + " (command_storage = " +
-            to_string(command_storage->root) + ") : " + *s, getCommandId(*this));
-    }
+        explainChangedFile(f, r, *s);
+    return !!s;
+}
+
+bool Command::check_if_file_newer(FileId id, ExplainReason r, bool throw_on_missing) const
+{
+    File f(id, getContext().getFileStorage());
+    auto s = f.isChanged(mtime, throw_on_missing);
+    if (s && isExplainNeeded())
+        explainChangedFile(f, r, *s);
     return !!s;
 }
 
+void Command::explainChangedFile(File &f, ExplainReason r, const String &s) const
+{
+    auto lwt = f.getFileData().last_write_time;
+    auto missing = lwt == fs::file_time_type::min();
+    if (missing && r == ExplainReason::OutputChanged)
+        r = ExplainReason::OutputMissing;
+    explainOutdated(*this, r,
+        toString(r) + " " + to_string(f.getPath()) + " (command_storage = " + to_string(command_storage->root) + ") : " + s,
+        f.getPath(), std::to_string(file_time_type2time_t(mtime)),
+        missing ? "missing" : std::to_string(file_time_type2time_t(lwt)));
+}
+
 bool Command::isOutdated() const
+{
+    if (!isOutdated1())
+        return false;
+    if (isExplainNeeded())
+        ExplainDatabase::writeOutputs(getHash(), outputs);
+    return true;
+}
+
+bool Command::isOutdated1() const
 {
     if (always)
     {
         if (isExplainNeeded())
-            EXPLAIN_OUTDATED("command", true, "always build", getCommandId(*this));
+            explainOutdated(*this, ExplainReason::Always, toString(ExplainReason::Always));
         return true;
     }
 
     if (!command_storage)
     {
         if (isExplainNeeded())
-            EXPLAIN_OUTDATED("command", true, "command storage is disabled", getCommandId(*this));
+            explainOutdated(*this, ExplainReason::NoCommandStorage, toString(ExplainReason::NoCommandStorage));
         return true;
     }
 
@@ -345,33 +296,67 @@ bool Command::isOutdated() const
         // we have insertion, no previous value available
         // so outdated
         if (isExplainNeeded())
-            EXPLAIN_OUTDATED("command", true, "new command (command_storage = " + to_string(command_storage->root) + "): " + print(), getCommandId(*this));
+        {
+            // outputs were produced by other version of this command
+            auto reason = !outputs.empty() && std::all_of(outputs.begin(), outputs.end(), [](const auto &o) { return fs::exists(o); })
+                ? ExplainReason::ArgumentsChanged : ExplainReason::NewCommand;
+            explainOutdated(*this, reason,
+                toString(reason) + " (command_storage = " + to_string(command_storage->root) + "): " + print(),
+                {}, {}, std::to_string(k));
+        }
         return true;
     }
     else
     {
         ((Command*)(this))->mtime = r.first->mtime;
+        ((Command*)(this))->implicit_input_ids = r.first->implicit_inputs;
         ((Command*)(this))->implicit_inputs.clear();
-        auto ii = r.first->getImplicitInputs(command_storage->getInternalStorage());
-        ((Command*)(this))->implicit_inputs.reserve(ii.size());
-        for (auto &&f : ii)
-            ((Command*)(this))->implicit_inputs.insert(*f);
+        ((Command*)(this))->implicit_inputs.reserve(implicit_input_ids.size());
+        for (auto &id : implicit_input_ids)
+            ((Command*)(this))->implicit_inputs.insert(getContext().getFileStorage().getFilePath(id));
         return isTimeChanged();
     }
 }
 
+void Command::getFilesToCheck(std::vector<FileId> &ids) const
+{
+    if (always || !command_storage)
+        return;
+    auto &fs = getContext().getFileStorage();
+    for (auto &i : inputs)
+        ids.push_back(fs.getFileId(i));
+    for (auto &i : outputs)
+        ids.push_back(fs.getFileId(i));
+    if (auto r = command_storage->find(getHash()))
+        ids.insert(ids.end(), r->implicit_inputs.begin(), r->implicit_inputs.end());
+}
+
 bool Command::isTimeChanged() const
 {
     try
     {
+        // record every changed file, not only the first one
+        if (isExplainNeeded())
+        {
+            bool changed = false;
+            for (auto &i : inputs)
+                changed |= check_if_file_newer(i, ExplainReason::InputChanged, true);
+            for (auto &i : outputs)
+                changed |= check_if_file_newer(i, ExplainReason::OutputChanged, false);
+            for (auto &i : implicit_input_ids)
+                changed |= check_if_file_newer(i, ExplainReason::ImplicitInputChanged, true);
+            return changed;
+        }
+
         return std::any_of(inputs.begin(), inputs.end(), [this](const auto &i) {
-                   return check_if_file_newer(i, "input", true);
+                   return check_if_file_newer(i, ExplainReason::InputChanged, true);
                }) ||
                std::any_of(outputs.begin(), outputs.end(), [this](const auto &i) {
-                   return check_if_file_newer(i, "output", false);
+                   return check_if_file_newer(i, ExplainReason::OutputChanged, false);
                }) ||
-               std::any_of(implicit_inputs.begin(), implicit_inputs.end(), [this](const auto &i) {
-                   return check_if_file_newer(i, "implicit input", true);
+               // implicit inputs came from command db, check them by id
+               std::any_of(implicit_input_ids.begin(), implicit_input_ids.end(), [this](const auto &i) {
+                   return check_if_file_newer(i, ExplainReason::ImplicitInputChanged, true);
                });
     }
     catch (std::exception &e)
@@ -642,7 +627,7 @@ bool Command::beforeCommand()
             "or set always = true"));
     }
 
-    if (!isOutdated())
+    if (up_to_date || !isOutdated())
     {
         executed_ = true;
         (*current_command)++;
@@ -726,7 +711,7 @@ void Command::afterCommand()
     auto &r = *command_storage->insert(k).first;
     r.hash = k;
     r.mtime = mtime;
-    r.setImplicitInputs(implicit_inputs, command_storage->getInternalStorage());
+    r.setImplicitInputs(implicit_inputs, getContext().getFileStorage());
     command_storage->async_command_log(r);
 }
 
@@ -877,7 +862,7 @@ void Command::printOutputs()
     if (write_output_to_file)
         write_file(fs::current_path() / SW_BINARY_DIR / "rsp" / std::to_string(getHash()) += ".txt", s);
     else
-        LOG_INFO(logger, s);
+        getBuildOutput().write(s);
 }
 
 String Command::makeErrorString()
@@ -1304,21 +1289,11 @@ void Command::printLog() const
 {
     if (silent)
         return;
-    static Executor eprinter(1);
     if (current_command)
     {
-        eprinter.push([c = std::static_pointer_cast<const Command>(shared_from_this())]
-        {
-            c->log_string = "[" + std::to_string((*c->current_command)++) + "/" + std::to_string(c->total_commands->load()) + "] " + c->getName();
-
-            // we cannot use this one because we must sync with printOutputs() call, both must use the same logger or (synced)stdout
-            //std::cout << "\r" << log_string;
-
-            // use this when logger won't call endl (custom sink is required)
-            //LOG_INFO(logger, "\r" + log_string);
-
-            LOG_INFO(logger, c->log_string);
-        });
+        // same thread as printOutputs(), so output goes after this line
+        log_string = "[" + std::to_string((*current_command)++) + "/" + std::to_string(total_commands->load()) + "] " + getName();
+        getBuildOutput().status(log_string);
     }
 }
 
@@ -1372,15 +1347,30 @@ bool Command::lessDuringExecution(const CommandNode &in) const
     return dependent_commands.size() > dependent_commands.size();
 }
 
+void Command::interrupt(bool force)
+{
+    // pid is owned by primitives and stays set after exit,
+    // so it is only read between onBeforeRun() and onEnd() to never hit a reused pid
+    std::unique_lock lk(process.m);
+    if (!process.running || pid == -1)
+        return;
+    if (terminate_process(pid, force))
+        LOG_TRACE(logger, "interrupting " << getName() << (force ? " (kill)" : ""));
+}
+
 void Command::onBeforeRun() noexcept
 {
     tid = std::this_thread::get_id();
     t_begin = Clock::now();
+    std::unique_lock lk(process.m);
+    process.running = true;
 }
 
 void Command::onEnd() noexcept
 {
     t_end = Clock::now();
+    std::unique_lock lk(process.m);
+    process.running = false;
 }
 
 Command &Command::operator|(Command &c2)
@@ -1414,6 +1404,18 @@ void CommandSequence::addCommand(const std::shared_ptr<Command> &c)
     commands.push_back(c);
 }
 
+void CommandSequence::interrupt(bool force)
+{
+    // commands run one by one, so only the last started one is alive
+    for (auto i = commands.rbegin(); i != commands.rend(); i++)
+    {
+        if (!(*i)->isExecuted())
+            continue;
+        (*i)->interrupt(force);
+        break;
+    }
+}
+
 void CommandSequence::execute1(std::error_code *ec)
 {
     for (auto &c : commands)
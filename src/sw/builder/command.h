@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "explain.h"
+#include "file.h"
 #include "node.h"
 
 #include <nlohmann/json_fwd.hpp>
@@ -176,6 +178,7 @@ public:
     bool silent = false; // no log record
     bool show_output = false; // no command output
     bool write_output_to_file = false;
+    bool up_to_date = false; // set by execution plan scan before dispatch
     int strict_order = 0; // used to execute this before other commands
     std::shared_ptr<ResourcePool> pool;
 
@@ -208,11 +211,15 @@ public:
     void execute(std::error_code &ec) override;
     void clean() const;
     bool isExecuted() const { return pid != -1 || executed_; }
+    /// terminates running process, builtin commands run in process and cannot be interrupted
+    virtual void interrupt(bool force = false);
 
     String getName(bool short_name = false) const override;
     size_t getHash() const override;
 
     virtual bool isOutdated() const;
+    /// files that are checked by isOutdated()
+    void getFilesToCheck(std::vector<FileId> &) const;
     bool needsResponseFile() const;
     bool needsResponseFile(size_t sz) const;
 
@@ -255,13 +262,30 @@ protected:
     bool executed_ = false;
     //std::atomic_bool executed_ = false;
 
-    virtual bool check_if_file_newer(const path &, const String &what, bool throw_on_missing) const;
+    virtual bool check_if_file_newer(const path &, ExplainReason, bool throw_on_missing) const;
+    bool check_if_file_newer(FileId, ExplainReason, bool throw_on_missing) const;
 
 private:
+    // process state shared with interrupting threads, not copied
+    struct ProcessState
+    {
+        std::mutex m;
+        bool running = false;
+
+        ProcessState() = default;
+        ProcessState(const ProcessState &) {}
+        ProcessState &operator=(const ProcessState &) { return *this; }
+    };
+
     const SwBuilderContext *swctx = nullptr;
+    ProcessState process;
     mutable size_t hash = 0;
     Arguments rsp_args;
     mutable String log_string;
+    // implicit inputs loaded from command db
+    // paths in implicit_inputs are kept for users of the public field,
+    // up to date checks go by ids
+    std::vector<FileId> implicit_input_ids;
 
     void execute0(std::error_code *ec);
     virtual void execute1(std::error_code *ec = nullptr);
@@ -270,7 +294,9 @@ private:
     void postProcess(bool ok = true);
     bool beforeCommand();
     void afterCommand();
+    bool isOutdated1() const;
     bool isTimeChanged() const;
+    void explainChangedFile(File &, ExplainReason, const String &) const;
     void printLog() const;
     size_t getHashAndSave() const;
     String makeErrorString();
@@ -295,6 +321,8 @@ struct SW_BUILDER_API CommandSequence : Command
 
     const std::vector<std::shared_ptr<Command>> &getCommands() { return commands; }
 
+    void interrupt(bool force = false) override;
+
 private:
     std::vector<std::shared_ptr<Command>> commands;
 
@@ -23,7 +23,6 @@
 
 #include <sw/manager/storage.h>
 
-#include <boost/thread/lock_types.hpp>
 #include <primitives/emitter.h>
 #include <primitives/executor.h>
 #include <primitives/date_time.h>
@@ -35,7 +34,7 @@
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "db_file");
 
-#define COMMAND_DB_FORMAT_VERSION 8
+#define COMMAND_DB_FORMAT_VERSION 9
 
 namespace sw
 {
@@ -83,41 +82,12 @@ static void write_str(std::vector<uint8_t> &vec, const String &val)
     memcpy(&vec[vsz], &val[0], sz);
 }
 
-CommandRecord::implicit_inputs_t CommandRecord::getImplicitInputs(detail::Storage &s) const
-{
-    implicit_inputs_t files;
-    for (auto &h : implicit_inputs)
-    {
-        boost::upgrade_lock lk(s.m_file_storage_by_hash);
-        auto i = s.file_storage_by_hash.find(h);
-        if (i == s.file_storage_by_hash.end())
-            throw SW_RUNTIME_ERROR("no such file");
-        // some extra check, remove later
-        if (i->second.empty())
-            throw SW_RUNTIME_ERROR("empty implicit input");
-        files.insert(&i->second);
-    }
-    return files;
-}
-
-void CommandRecord::setImplicitInputs(const Files &files, detail::Storage &s)
+void CommandRecord::setImplicitInputs(const Files &files, FileStorage &fs)
 {
     implicit_inputs.clear(); // clear first!
-
+    implicit_inputs.reserve(files.size());
     for (auto &f : files)
-    {
-        auto str = normalize_path(f);
-        auto h = std::hash<path>()(str);
-        implicit_inputs.insert(h);
-
-        boost::upgrade_lock lk(s.m_file_storage_by_hash);
-        auto i = s.file_storage_by_hash.find(h);
-        if (i == s.file_storage_by_hash.end())
-        {
-            boost::upgrade_to_unique_lock lk2(lk);
-            s.file_storage_by_hash[h] = str;
-        }
-    }
+        implicit_inputs.push_back(fs.getFileId(f));
 }
 
 FileDb::FileDb(const SwBuilderContext &swctx)
@@ -125,9 +95,7 @@ FileDb::FileDb(const SwBuilderContext &swctx)
 {
 }
 
-static auto file_hash(const path &p) { return std::hash<path>()(p); }
-
-void FileDb::write(std::vector<uint8_t> &v, const CommandRecord &f, const detail::Storage &s)
+void FileDb::write(std::vector<uint8_t> &v, const CommandRecord &f)
 {
     v.clear();
 
@@ -142,16 +110,8 @@ void FileDb::write(std::vector<uint8_t> &v, const CommandRecord &f, const detail
 
     auto n = f.implicit_inputs.size();
     write_int(v, n);
-    for (auto &h : f.implicit_inputs)
-    {
-        boost::upgrade_lock lk(s.m_file_storage_by_hash);
-        auto i = s.file_storage_by_hash.find(h);
-        if (i == s.file_storage_by_hash.end())
-            throw SW_RUNTIME_ERROR("no such file");
-        auto p = i->second;
-        lk.unlock();
-        write_int(v, file_hash(normalize_path(p)));
-    }
+    for (auto &id : f.implicit_inputs)
+        write_int(v, id);
 }
 
 static String getFilesSuffix()
@@ -159,8 +119,22 @@ static String getFilesSuffix()
     return ".files";
 }
 
-static void load(const path &fn, Files &files, std::unordered_map<size_t, path> &files2, ConcurrentCommandStorage &commands)
+// file record: id, path
+static void write_file_record(primitives::BinaryStream &b, FileId id, const path &p)
+{
+    auto s = to_string(normalize_path(p));
+    auto sz = sizeof(id) + s.size() + 1;
+    b.write(sz);
+    b.write(id);
+    b.write(s);
+}
+
+// ids on disk are local to the file they were written to,
+// so we remap them into current file storage
+static void load(const path &fn, FileStorage &fs, ConcurrentCommandStorage &commands)
 {
+    std::unordered_map<FileId, FileId> ids;
+
     // files
     auto fn_with_suffix = path(fn) += getFilesSuffix();
     if (fs::exists(fn_with_suffix))
@@ -181,12 +155,11 @@ static void load(const path &fn, Files &files, std::unordered_map<size_t, path>
                 continue;
 
             // file
+            FileId id;
+            b.read(id);
             String s;
             b.read(s);
-            auto p = fs::u8path(s);
-            files.insert(p);
-
-            files2[file_hash(p)] = p;
+            ids[id] = fs.getFileId(fs::u8path(s));
         }
     }
 
@@ -222,58 +195,54 @@ static void load(const path &fn, Files &files, std::unordered_map<size_t, path>
 
             size_t n;
             b.read(n);
+            r.first->implicit_inputs.clear();
             r.first->implicit_inputs.reserve(n);
             while (n--)
             {
-                b.read(h);
-                auto &f = files2[h];
-                if (!f.empty())
-                {
-                    //r.first->implicit_inputs.insert(files2[h]);
-                    r.first->implicit_inputs.insert(h);
-                }
+                FileId id;
+                b.read(id);
+                auto i = ids.find(id);
+                if (i != ids.end())
+                    r.first->implicit_inputs.push_back(i->second);
             }
         }
     }
 }
 
-void FileDb::load(Files &files, std::unordered_map<size_t, path> &files2, ConcurrentCommandStorage &commands, const path &root) const
+void FileDb::load(ConcurrentCommandStorage &commands, const path &root) const
 {
-    sw::load(getCommandsDbFilename(root), files, files2, commands);
-    sw::load(getCommandsLogFileName(root), files, files2, commands);
+    sw::load(getCommandsDbFilename(root), swctx.getFileStorage(), commands);
+    sw::load(getCommandsLogFileName(root), swctx.getFileStorage(), commands);
 }
 
-void FileDb::save(const Files &files, const detail::Storage &s, ConcurrentCommandStorage &commands, const path &root) const
+void FileDb::save(ConcurrentCommandStorage &commands, const path &root) const
 {
     std::vector<uint8_t> v;
+    auto &fs = swctx.getFileStorage();
 
-    // files
+    // files and commands
     {
+        std::unordered_set<FileId> files;
+        primitives::BinaryStream bf(10'000'000); // reserve amount
         primitives::BinaryStream b(10'000'000); // reserve amount
-        for (auto &f : files)
+        for (const auto &[k, r] : commands)
         {
-            auto s = to_string(normalize_path(f));
-            auto sz = s.size() + 1;
+            for (auto &id : r.implicit_inputs)
+            {
+                if (files.insert(id).second)
+                    write_file_record(bf, id, fs.getFilePath(id));
+            }
+
+            write(v, r);
+            auto sz = v.size();
             b.write(sz);
-            b.write(s);
+            b.write(v.data(), v.size());
         }
-        if (!b.empty())
+        if (!bf.empty())
         {
             auto p = getCommandsDbFilename(root) += getFilesSuffix();
             fs::create_directories(p.parent_path());
-            b.save(p);
-        }
-    }
-
-    // commands
-    {
-        primitives::BinaryStream b(10'000'000); // reserve amount
-        for (const auto &[k, r] : commands)
-        {
-            write(v, r, s);
-            auto sz = v.size();
-            b.write(sz);
-            b.write(v.data(), v.size());
+            bf.save(p);
         }
         if (!b.empty())
         {
@@ -337,7 +306,7 @@ void CommandStorage::async_command_log(const CommandRecord &r)
 
         {
             // write record to vector v
-            fdb.write(v, r, s);
+            fdb.write(v, r);
 
             auto &l = s.getCommandLog(swctx, root);
             auto sz = v.size();
@@ -348,15 +317,19 @@ void CommandStorage::async_command_log(const CommandRecord &r)
 
         {
             auto &l = s.getFileLog(swctx, root);
-            for (auto &&f : r.getImplicitInputs(s))
+            v.clear();
+            for (auto &id : r.implicit_inputs)
             {
-                auto r = s.file_storage.insert(*f);
-                if (!r.second)
+                if (!s.logged_files.insert(id).second)
                     continue;
-                auto s = to_string(normalize_path(*f));
-                auto sz = s.size() + 1;
-                fwrite(&sz, sizeof(sz), 1, l.f.getHandle());
-                fwrite(&s[0], sz, 1, l.f.getHandle());
+                auto str = to_string(normalize_path(swctx.getFileStorage().getFilePath(id)));
+                write_int(v, sizeof(id) + str.size() + 1);
+                write_int(v, id);
+                write_str(v, str);
+            }
+            if (!v.empty())
+            {
+                fwrite(&v[0], v.size(), 1, l.f.getHandle());
                 fflush(l.f.getHandle());
             }
         }
@@ -381,6 +354,7 @@ void detail::Storage::closeLogs()
 {
     commands.reset();
     files.reset();
+    logged_files.clear(); // file log is removed on close
 }
 
 void CommandStorage::closeLogs()
@@ -424,12 +398,14 @@ detail::FileHolder &detail::Storage::getFileLog(const SwBuilderContext &swctx, c
 
 void CommandStorage::load()
 {
-    fdb.load(s.file_storage, s.file_storage_by_hash, s.storage, root);
+    ScopedConcurrentContext qsbr;
+    fdb.load(s.storage, root);
 }
 
 void CommandStorage::save1()
 {
-    fdb.save(s.file_storage, s, s.storage, root);
+    ScopedConcurrentContext qsbr;
+    fdb.save(s.storage, root);
 }
 
 ConcurrentCommandStorage &CommandStorage::getStorage()
@@ -447,6 +423,11 @@ std::pair<CommandRecord *, bool> CommandStorage::insert(size_t hash)
     return getStorage().insert(hash);
 }
 
+CommandRecord *CommandStorage::find(size_t hash) const
+{
+    return s.storage.find(hash);
+}
+
 path CommandStorage::getLockFileName() const
 {
     return root / "build";
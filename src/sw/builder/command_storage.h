@@ -19,8 +19,8 @@
 #pragma once
 
 #include "concurrent_map.h"
+#include "file.h"
 
-#include <boost/thread/shared_mutex.hpp>
 #include <primitives/lock.h>
 #include <primitives/templates.h>
 
@@ -30,6 +30,7 @@ namespace sw
 {
 
 struct CommandStorage;
+struct FileStorage;
 
 namespace detail
 {
@@ -49,15 +50,14 @@ struct FileHolder
 
 struct CommandRecord
 {
-    using implicit_inputs_t = std::unordered_set<path*>;
+    using implicit_inputs_t = std::vector<FileId>;
 
     size_t hash = 0;
     fs::file_time_type mtime = fs::file_time_type::min();
-    //Files implicit_inputs;
-    std::unordered_set<size_t> implicit_inputs;
+    // ids in build-wide file storage
+    implicit_inputs_t implicit_inputs;
 
-    implicit_inputs_t getImplicitInputs(detail::Storage &) const;
-    void setImplicitInputs(const Files &, detail::Storage &);
+    void setImplicitInputs(const Files &, FileStorage &);
 };
 
 using ConcurrentCommandStorage = ConcurrentMap<size_t, CommandRecord>;
@@ -71,10 +71,9 @@ struct Storage
     ConcurrentCommandStorage storage;
     std::unique_ptr<FileHolder> commands;
 
-    Files file_storage;
-    mutable boost::upgrade_mutex m_file_storage_by_hash;
-    std::unordered_map<size_t, path> file_storage_by_hash;
     std::unique_ptr<FileHolder> files;
+    // files already written to the current files log
+    std::unordered_set<FileId> logged_files;
 
     void closeLogs();
     FileHolder &getCommandLog(const SwBuilderContext &swctx, const path &root);
@@ -89,10 +88,10 @@ struct FileDb
 
     FileDb(const SwBuilderContext &swctx);
 
-    void load(Files &files, std::unordered_map<size_t, path> &files2, ConcurrentCommandStorage &commands, const path &root) const;
-    void save(const Files &files, const detail::Storage &, ConcurrentCommandStorage &commands, const path &root) const;
+    void load(ConcurrentCommandStorage &commands, const path &root) const;
+    void save(ConcurrentCommandStorage &commands, const path &root) const;
 
-    static void write(std::vector<uint8_t> &, const CommandRecord &, const detail::Storage &);
+    static void write(std::vector<uint8_t> &, const CommandRecord &);
 };
 
 struct SW_BUILDER_API CommandStorage
@@ -111,6 +110,7 @@ struct SW_BUILDER_API CommandStorage
     void add_user();
     void free_user();
     std::pair<CommandRecord *, bool> insert(size_t hash);
+    CommandRecord *find(size_t hash) const;
 
 private:
     FileDb fdb;
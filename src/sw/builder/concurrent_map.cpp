@@ -18,11 +18,83 @@
 
 #include "concurrent_map.h"
 
+#include <atomic>
+
 namespace sw
 {
 
 //SW_DEFINE_GLOBAL_STATIC_FUNCTION(ConcurrentContext, getConcurrentContext)
 
+namespace
+{
+
+struct ThreadContext
+{
+    ConcurrentContext ctx;
+    int n = 0;
+};
+
+thread_local ThreadContext thread_context;
+
+struct BatchThreadContext
+{
+    uint64_t batch = 0;
+    ConcurrentContext ctx;
+    int tasks = 0;
+};
+
+thread_local BatchThreadContext batch_thread_context;
+std::atomic<uint64_t> batch_ids;
+
+}
+
+ScopedConcurrentContext::ScopedConcurrentContext()
+{
+    if (thread_context.n++ == 0)
+        thread_context.ctx = createConcurrentContext();
+}
+
+ScopedConcurrentContext::~ScopedConcurrentContext()
+{
+    // leaving last scope is quiescent state too
+    if (--thread_context.n == 0)
+        destroyConcurrentContext(thread_context.ctx);
+}
+
+ConcurrentContextBatch::ConcurrentContextBatch(int update_period)
+    : id(++batch_ids), update_period(update_period)
+{
+}
+
+ConcurrentContextBatch::~ConcurrentContextBatch()
+{
+    // contexts are plain indices, any thread may destroy them
+    for (auto ctx : contexts)
+        destroyConcurrentContext(ctx);
+}
+
+void ConcurrentContextBatch::enter()
+{
+    auto &t = batch_thread_context;
+    if (t.batch == id)
+        return;
+    // thread switched batches, old one keeps its context until destroyed
+    t.batch = id;
+    t.ctx = createConcurrentContext();
+    t.tasks = 0;
+    std::unique_lock lk(m);
+    contexts.push_back(t.ctx);
+}
+
+void ConcurrentContextBatch::leave()
+{
+    auto &t = batch_thread_context;
+    if (t.batch != id)
+        return;
+    if (++t.tasks % update_period == 0)
+        updateConcurrentContext(t.ctx);
+}
+
 ConcurrentContext createConcurrentContext()
 {
     return junction::DefaultQSBR.createContext();
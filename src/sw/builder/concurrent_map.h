@@ -23,12 +23,73 @@
 #include <primitives/templates.h>
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace sw
 {
 
 using ConcurrentContext = junction::QSBR::Context;
 
+/// Registers current thread in QSBR while alive.
+/// Threads must be registered while they hold values of concurrent maps.
+/// Memory of replaced values and retired maps is freed only after
+/// every registered thread passed quiescent state (scope end or update).
+/// Scopes may be nested.
+struct SW_BUILDER_API ScopedConcurrentContext
+{
+    ScopedConcurrentContext();
+    ScopedConcurrentContext(const ScopedConcurrentContext &) = delete;
+    ScopedConcurrentContext &operator=(const ScopedConcurrentContext &) = delete;
+    ~ScopedConcurrentContext();
+};
+
+/// Keeps one QSBR context per thread over many short tasks.
+/// Creating and destroying contexts takes the global QSBR mutex,
+/// so a scope per task serializes large plans on it.
+/// Thread is registered on its first enter() and reports quiescent state
+/// every update_period leave() calls. Idle threads delay reclamation
+/// until the batch is destroyed, so keep batches short lived (one plan run).
+struct SW_BUILDER_API ConcurrentContextBatch
+{
+    ConcurrentContextBatch(int update_period = 64);
+    ConcurrentContextBatch(const ConcurrentContextBatch &) = delete;
+    ConcurrentContextBatch &operator=(const ConcurrentContextBatch &) = delete;
+    ~ConcurrentContextBatch();
+
+    /// call before the task touches concurrent maps
+    void enter();
+    /// call after the task, when thread holds no values
+    void leave();
+
+private:
+    uint64_t id;
+    int update_period;
+    std::mutex m;
+    std::vector<ConcurrentContext> contexts;
+};
+
+namespace detail
+{
+
+template <class T>
+void retire(T *p)
+{
+    struct Retired
+    {
+        T *p;
+
+        void destroy()
+        {
+            delete p;
+            delete this;
+        }
+    };
+    junction::DefaultQSBR.enqueue(&Retired::destroy, new Retired{ p });
+}
+
+}
+
 template <class K, class V>
 struct ConcurrentMap
 {
@@ -44,16 +105,13 @@ struct ConcurrentMap
 
     ~ConcurrentMap()
     {
-        // causes crashes
-        /*if (!map)
-            return;
-        for (auto i = getIterator(); i.isValid(); i.next())
-            delete i.getValue();
-        map.reset();*/
+        retire();
     }
 
+    /// not thread safe
     void clear()
     {
+        retire();
         map = std::make_unique<MapType>();
     }
 
@@ -106,13 +164,8 @@ struct ConcurrentMap
 
     insert_type insert(K k, const V &v = V())
     {
-        if constexpr (std::is_pointer_v<V>)
-            return insert(k, v, [](auto *v)
-        {
-            junction::DefaultQSBR.enqueue(&V::destroy, v);
-        });
-        else
-            return insert(k, v, [](auto *v) {});
+        // loser of insert race may still use its value
+        return insert(k, v, [](auto *v) { detail::retire(v); });
     }
 
     insert_type insert_ptr(K k, const V &v = V())
@@ -123,6 +176,14 @@ struct ConcurrentMap
             return insert(k, v, [](auto *v) {});
     }
 
+    /// returns nullptr if key is not present, does not insert
+    V *find(K k) const
+    {
+        if (k == 0)
+            return nullptr;
+        return map->get(k);
+    }
+
     V &operator[](K k)
     {
         return *insert(k).first;
@@ -170,6 +231,24 @@ struct ConcurrentMap
 private:
     std::unique_ptr<MapType> map;
     //std::mutex m;
+
+    // readers may still hold values, so map is freed later
+    void retire()
+    {
+        if (!map)
+            return;
+        struct RetiredMap
+        {
+            std::unique_ptr<MapType> map;
+
+            ~RetiredMap()
+            {
+                for (typename MapType::Iterator i(*map); i.isValid(); i.next())
+                    delete i.getValue();
+            }
+        };
+        detail::retire(new RetiredMap{ std::move(map) });
+    }
 };
 
 template <class V>
@@ -0,0 +1,200 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "deps_parser.h"
+
+#include <cstring>
+
+namespace sw
+{
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// continuation is '\' + lf or '\' + crlf, returns its length or 0
+// trailing '\' is also considered as continuation
+static size_t continuation_size(const char *p, const char *e)
+{
+    if (p == e || *p != '\\')
+        return 0;
+    if (p + 1 == e)
+        return 1;
+    if (p[1] == '\n')
+        return 2;
+    if (p[1] == '\r' && p + 2 != e && p[2] == '\n')
+        return 3;
+    return 0;
+}
+
+// first rule ends on a new line that starts with non space
+static std::string_view first_rule(std::string_view s)
+{
+    auto b = s.data();
+    auto e = b + s.size();
+    auto p = b;
+    while (p != e)
+    {
+        auto nl = (const char *)memchr(p, '\n', e - p);
+        if (!nl || nl + 1 == e)
+            break;
+        // next line may start with a file name right after continuation
+        bool continued = (nl - b >= 1 && nl[-1] == '\\') || (nl - b >= 2 && nl[-1] == '\r' && nl[-2] == '\\');
+        if (!continued && !is_space(nl[1]))
+            return { b, (size_t)(nl - b) };
+        p = nl + 1;
+    }
+    return s;
+}
+
+// skip target
+//  use exactly ": " because on windows target is 'C:/path/to/file: '
+//                                           skip up to this space ^
+static size_t skip_target(std::string_view s)
+{
+    auto b = s.data();
+    auto e = b + s.size();
+    auto p = b;
+    while (p != e)
+    {
+        auto c = (const char *)memchr(p, ':', e - p);
+        if (!c)
+            break;
+        if (c + 1 == e || is_space(c[1]))
+            return c + 1 - b;
+        // target without deps on the same line
+        if (continuation_size(c + 1, e))
+            return c + 1 - b;
+        p = c + 1;
+    }
+    return 0;
+}
+
+void parse_deps_gnu(std::string_view text, const DepsCallback &cb)
+{
+    auto s = first_rule(text);
+    s.remove_prefix(skip_target(s));
+
+    // used only for names with escapes
+    std::string buf;
+
+    auto p = s.data();
+    auto e = p + s.size();
+    while (p != e)
+    {
+        // skip spaces and line continuations
+        if (is_space(*p))
+        {
+            p++;
+            continue;
+        }
+        if (auto n = continuation_size(p, e))
+        {
+            p += n;
+            continue;
+        }
+
+        // file name
+        auto begin = p;
+        bool escaped = false;
+        while (p != e && !is_space(*p))
+        {
+            if (*p == '\\')
+            {
+                // protobuf does not put space after filename
+                if (continuation_size(p, e))
+                    break;
+                if (p[1] == ' ' || p[1] == '\t' || p[1] == '#')
+                {
+                    escaped = true;
+                    p += 2;
+                    continue;
+                }
+            }
+            else if (*p == '$' && p + 1 != e && p[1] == '$')
+            {
+                escaped = true;
+                p += 2;
+                continue;
+            }
+            p++;
+        }
+        if (p == begin)
+            continue;
+
+        if (!escaped)
+        {
+            cb({ begin, (size_t)(p - begin) });
+            continue;
+        }
+
+        buf.clear();
+        for (auto i = begin; i != p; i++)
+        {
+            if (i + 1 != p
+                && ((*i == '\\' && (i[1] == ' ' || i[1] == '\t' || i[1] == '#'))
+                || (*i == '$' && i[1] == '$')))
+                i++;
+            buf += *i;
+        }
+        cb(buf);
+    }
+}
+
+void parse_deps_msvc(std::string &text, std::string_view prefix, bool remove_first_line, const DepsCallback &cb)
+{
+    auto b = text.data();
+    auto e = b + text.size();
+    auto r = b; // read
+    auto w = b; // write
+
+    if (remove_first_line)
+    {
+        auto nl = (const char *)memchr(r, '\n', e - r);
+        r = nl ? (char *)nl + 1 : e;
+    }
+
+    while (r != e)
+    {
+        auto nl = (char *)memchr(r, '\n', e - r);
+        auto line_end = nl ? nl : e;
+        auto next = nl ? nl + 1 : e;
+        size_t len = line_end - r;
+        if (len >= prefix.size() && memcmp(r, prefix.data(), prefix.size()) == 0)
+        {
+            auto ib = r + prefix.size();
+            auto ie = line_end;
+            while (ib != ie && is_space(*ib))
+                ib++;
+            while (ib != ie && is_space(ie[-1]))
+                ie--;
+            cb({ ib, (size_t)(ie - ib) });
+        }
+        else
+        {
+            if (w != r)
+                memmove(w, r, next - r);
+            w += next - r;
+        }
+        r = next;
+    }
+    text.resize(w - b);
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace sw
+{
+
+/// receives a file name, view is valid only during the call
+using DepsCallback = std::function<void(std::string_view)>;
+
+/// Parses make style deps file (gcc -MD).
+///
+/// file.o: dep1.cpp dep1.h dep\ with\ spaces.h
+///
+/// Only the first rule is taken, other rules may contain same .o but for c++ modules.
+/// Handles escaped spaces, '\#', '$$' and line continuations ('\' before lf or crlf).
+/// Does not allocate unless a file name contains escapes.
+SW_BUILDER_API
+void parse_deps_gnu(std::string_view text, const DepsCallback &);
+
+/// Parses /showIncludes output.
+/// Lines with prefix are removed from text and reported to callback (trimmed).
+/// Text is compacted in place.
+SW_BUILDER_API
+void parse_deps_msvc(std::string &text, std::string_view prefix, bool remove_first_line, const DepsCallback &);
+
+}
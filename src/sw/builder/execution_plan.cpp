@@ -18,16 +18,18 @@
 
 #include "execution_plan.h"
 
+#include "concurrent_map.h"
+#include "file_storage.h"
+#include "module_mapper.h"
+#include "output.h"
+
 #include <sw/support/exceptions.h>
 
-// clang(win)+linux workaround
-#if defined(__linux__) && defined(__clang__)
-#define BOOST_ASIO_HAS_CO_AWAIT
-#define BOOST_ASIO_HAS_STD_COROUTINE
-#endif
-#include <boost/asio.hpp>
 #include <nlohmann/json.hpp>
 #include <primitives/exceptions.h>
+#include <primitives/templates.h>
+
+#include <thread>
 
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "explan");
@@ -35,284 +37,27 @@ DECLARE_STATIC_LOGGER(logger, "explan");
 namespace sw
 {
 
-uint16_t get_module_mapper_port() {
-    static const auto port = []() {
-        using tcp = boost::asio::ip::tcp;
-        boost::asio::io_context ctx;
-        tcp::acceptor acceptor(ctx, tcp::endpoint(tcp::v6(), 0));
-        return acceptor.local_endpoint().port();
-    }();
-    return port;
-}
+// graceful termination period before kill
+static const auto kill_timeout = std::chrono::seconds(5);
 
-struct gcc_modules_server {
-    const ExecutionPlan &ep;
-    boost::asio::io_context ctx_main;
-    boost::asio::io_context ctx_headers;
-    std::thread t_main;
-    std::thread t_headers;
-
-    ~gcc_modules_server() {
-        ctx_main.stop();
-        ctx_headers.stop();
-        if (t_headers.joinable())
-            t_headers.join();
-        if (t_main.joinable())
-            t_main.join();
-    }
-    void run() {
-        // compile handling
-        boost::asio::co_spawn(ctx_main, accept(ctx_main, get_module_mapper_port()), boost::asio::detached);
-        // scan handling
-        boost::asio::co_spawn(ctx_main, accept(ctx_main, get_module_mapper_port() + 1, true), boost::asio::detached);
-        // import header handling
-        boost::asio::co_spawn(ctx_headers, accept(ctx_headers, get_module_mapper_port() + 2, true), boost::asio::detached);
-        t_main = std::thread{[this](){
-            try {
-                ctx_main.run();
-            } catch (...) {}
-        }};
-        t_headers = std::thread{[this](){
-            try {
-                ctx_headers.run();
-            } catch (...) {}
-        }};
-    }
-    boost::asio::awaitable<void> accept(auto &&ctx, auto port, bool scan = false) {
-        using tcp = boost::asio::ip::tcp;
-        tcp::acceptor acceptor(ctx, tcp::endpoint(tcp::v6(), port));
-        while (1) {
-            auto sock = co_await acceptor.async_accept(boost::asio::use_awaitable);
-            boost::asio::co_spawn(ctx, scan ? process_scan(std::move(sock)) : process2(std::move(sock)), boost::asio::detached);
-        }
-    }
-    boost::asio::awaitable<void> process2(auto socket) {
-        using namespace boost::asio;
-        auto reply = [&socket](auto &&line, std::string s) {
-            if (line.ends_with(';'))
-                s += " ;";
-            s += "\n";
-            return async_write(socket, buffer(s), use_awaitable);
-        };
-        struct data {
-            path out;
-            String source;
-            String export_module;
-            std::unordered_map<String, path> import_modules;
-            std::unordered_map<String, path> header_units;
-
-            ~data() {
-                if (!source.empty())
-                    write_file_module_mapper();
-            }
-            void write_file_module_mapper() {
-                std::ostringstream ss;
-                ss << "$root ." << "\n";
-                if (!export_module.empty())
-                    ss << export_module << " " << export_module << "\n";
-                auto print = [&ss](auto &&what) {
-                    for (auto &&[k,v] : what)
-                        ss << k << " " << v.string() << "\n";
-                };
-                print(import_modules);
-                print(header_units);
-                write_file(out.parent_path() / (out.stem().stem() += ".map"), ss.str());
-            }
-            void write() {
-                // follow msvc here
-                nlohmann::json j;
-                j["Version"] = "1.1";
-                auto &jd = j["Data"];
-                jd["Source"] = source;
-                jd["ProvidedModule"] = export_module;
-                for (auto &&[n,p] : import_modules) {
-                    nlohmann::json m;
-                    m["Name"] = n;
-                    m["BMI"] = p.u8string();
-                    jd["ImportedModules"].push_back(m);
-                }
-                for (auto &&[n,p] : header_units) {
-                    nlohmann::json m;
-                    m["Name"] = n;
-                    m["BMI"] = p.u8string();
-                    jd["ImportedHeaderUnits"].push_back(m);
-                }
-                write_file(out, j.dump());
-            }
-        } d;
-        while (1) {
-            std::string buf;
-            co_await async_read_until(socket, dynamic_buffer(buf, 1024), "\n", use_awaitable);
-            auto lines = split_lines(buf);
-            for (auto &&line : lines) {
-                if (line.starts_with("HELLO")) {
-                    auto parts = split_string(line, " '"); // hello,ver,prog,ident,;
-                    auto parts2 = split_string(parts[3], ":");
-                    d.source = parts2[0];
-                    d.out = parts2[1];
-                    co_await reply(line, "HELLO 1 sw");
-                } else if (line.starts_with("MODULE-REPO")) {
-                    co_await reply(line, "PATHNAME .");
-                } else if (line.starts_with("MODULE-EXPORT")) {
-                    auto module = split_string(line, " ")[1]; // module,name
-                    d.export_module = module;
-                    co_await reply(line, "PATHNAME " + module + ".cmi");
-                } else if (line.starts_with("MODULE-IMPORT")) {
-                    auto module = split_string(line, " ")[1]; // module,name
-                    bool header = path{module}.is_absolute();
-                    if (header) {
-                        d.header_units[module] = d.out.parent_path() / "gcm.cache" / ("." + module + ".gcm");
-                    } else
-                        d.import_modules[module] = d.out.parent_path() / (module + ".cmi");
-                    d.write();
-                    if (header)
-                        co_await reply(line, "PATHNAME gcm.cache/." + module + ".gcm");
-                    else
-                        co_await reply(line, "PATHNAME " + module + ".cmi");
-                } else if (line.starts_with("MODULE-COMPILED")) {
-                    d.write();
-                    co_await reply(line, "OK"); // could be any string actually
-                } else {
-                    co_await reply(line, "ERROR 'Unknown command: " + line.substr(0, line.find(' ')) + "'");
-                    co_return;
-                }
-                /*
-                "INCLUDE-TRANSLATE"
-                "INVOKE"
-                */
-            }
-        }
-    }
-    boost::asio::awaitable<void> process_scan(auto socket) {
-        using namespace boost::asio;
-        auto reply = [&socket](auto &&line, std::string s) {
-            if (line.ends_with(';'))
-                s += " ;";
-            LOG_TRACE(logger, "socket " << socket.native_handle() << "< " << s);
-            s += "\n";
-            return async_write(socket, buffer(s), use_awaitable);
-        };
-        builder::Command *this_command{nullptr};
-        builder::Command::msvc_modules_scan_data d;
-        std::string module;
-        while (1) {
-            std::string buf;
-            co_await async_read_until(socket, dynamic_buffer(buf, 1024), "\n", use_awaitable);
-            auto lines = split_lines(buf);
-            std::string error;
-            try {
-                for (auto &&line : lines) {
-                    LOG_TRACE(logger, "socket " << socket.native_handle() << "> " << line);
-                    if (line.starts_with("HELLO")) {
-                        auto parts = split_string(line, " '"); // hello,ver,prog,ident,;
-                        auto parts2 = split_string(parts[3], ":");
-                        d.source = parts2[0];
-                        d.out = parts2[1];
-                        co_await reply(line, "HELLO 1 sw");
-                    } else if (line.starts_with("MODULE-REPO")) {
-                        co_await reply(line, "PATHNAME .");
-                    } else if (line.starts_with("MODULE-EXPORT")) {
-                        module = split_string(line, " ")[1]; // module,name
-                        bool header = path{module}.is_absolute();
-                        if (header) {
-                            d.export_module = module;
-                            d.write();
-                            co_await reply(line, "PATHNAME " + (d.out.parent_path() / d.out.stem().stem()).string() + ".gcm");
-                        }
-                        else {
-                            d.export_module = module;
-                            d.write();
-                            co_await reply(line, "PATHNAME " + module + ".cmi");
-                        }
-                    } else if (line.starts_with("MODULE-IMPORT")) {
-                        auto module = split_string(line, " ")[1]; // module,name
-                        bool header = path{module}.is_absolute();
-                        if (header) {
-                            d.header_units.push_back(module);
-                            // we create import header immediately
-                            auto fn = d.out.parent_path() / ("gcm.cache/." + module + ".gcm");
-                            if (!fs::exists(fn)) {
-                                if (!this_command) {
-                                    auto &cmds = ep.getCommands();
-                                    auto it = std::find_if(cmds.begin(), cmds.end(), [&d](auto &&v){ return static_cast<builder::Command*>(v)->outputs.contains(d.out); });
-                                    if (it == cmds.end()) {
-                                        co_await reply(line, "ERROR 'Cannot find according command for import header: " + module + "'");
-                                        co_return;
-                                    }
-                                    this_command = static_cast<builder::Command*>(*it);
-                                }
-                                auto &from = *this_command;
-                                auto cmd = std::make_shared<builder::Command>(from.getContext());
-                                auto &c = *cmd;
-                                c.working_directory = from.working_directory;
-                                c.command_storage = from.command_storage;
-                                c.environment = from.environment;
-                                c.addOutput(fn);
-                                c.setProgram(from.arguments[0]->toString());
-                                for (int i = 0; auto &&a : from.arguments) {
-                                    if (i++) {
-                                        if (0
-                                            || a->toString().starts_with("-o")
-                                            )
-                                            continue;
-                                        if (a->toString().starts_with("-fmodule-mapper")) {
-                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(
-                                                "-fmodule-mapper=:::" + std::to_string(get_module_mapper_port() + 2) + "?"s + module + ":"
-                                                + d.out.parent_path().string() + "/gcm.cache" + module + ".ifc.json"));
-                                            continue;
-                                        }
-                                        if (a->toString().starts_with("-E")) {
-                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>("-c"s));
-                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>("-xc++-header"s));
-                                            continue;
-                                        }
-                                        if (a->toString().starts_with("/"))
-                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(module));
-                                        else
-                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(a->toString()));
-                                        continue;
-                                    }
-                                }
-                                LOG_INFO(logger, "building import header: " << fn);
-                                LOG_TRACE(logger, "import header command: " << fn << "\n" << c.print());
-                                c.execute();
-                            }
-                        }
-                        else
-                            d.import_modules.push_back(module);
-                        d.write();
-                        if (header)
-                            co_await reply(line, "PATHNAME gcm.cache/." + module + ".gcm");
-                        else
-                            co_await reply(line, "PATHNAME " + module + ".cmi");
-                    } else if (line.starts_with("MODULE-COMPILED")) {
-                        co_await reply(line, "OK"); // could be any string actually
-                    } else if (line.starts_with("INCLUDE-TRANSLATE")) {
-                        co_await reply(line, "BOOL TRUE");
-                    } else {
-                        co_await reply(line, "ERROR 'Unknown command: " + line.substr(0, line.find(' ')) + "'");
-                        co_return;
-                    }
-                    /*
-                    ""
-                    "INVOKE"
-                    */
-                }
-            } catch (std::exception &e) {
-                LOG_ERROR(logger, "ERROR: " << e.what());
-                error = e.what();
-            }
-            if (!error.empty()) {
-                co_await reply(""s, "ERROR '"s + error + "'");
-                co_return;
-            }
-        }
-    }
+// executing plans, used to stop them on ctrl-c
+static std::mutex plans_m;
+static std::unordered_set<const ExecutionPlan *> plans;
+
+// shared with escalation threads, so they can outlive execution
+struct ExecutionPlan::RunningCommands
+{
+    std::mutex m;
+    std::condition_variable cv; // notified when interrupted command finishes
+    std::unordered_map<PtrT, std::shared_ptr<T>> commands;
+    USet interrupted;
+    bool escalating = false;
 };
 
-ExecutionPlan::ExecutionPlan(USet &cmds)
+ExecutionPlan::ExecutionPlan(USet &cmds, bool transitive_reduction)
+    : running_commands(std::make_shared<RunningCommands>())
 {
-    init(cmds);
+    init(cmds, transitive_reduction);
 }
 
 ExecutionPlan::~ExecutionPlan()
@@ -335,9 +80,54 @@ ExecutionPlan::~ExecutionPlan()
 
 void ExecutionPlan::stop(bool interrupt_running_commands)
 {
-    if (interrupt_running_commands)
-        SW_UNIMPLEMENTED;
     interrupted = true;
+    if (interrupt_running_commands)
+        interruptRunningCommands();
+}
+
+bool ExecutionPlan::interruptAll()
+{
+    std::unique_lock lk(plans_m);
+    for (auto p : plans)
+    {
+        p->interrupted = true;
+        p->interruptRunningCommands();
+    }
+    return !plans.empty();
+}
+
+void ExecutionPlan::interruptRunningCommands() const
+{
+    auto rc = running_commands;
+    {
+        std::unique_lock lk(rc->m);
+        for (auto &[p, _] : rc->commands)
+        {
+            if (!rc->interrupted.insert(p).second)
+                continue;
+            if (auto c = dynamic_cast<builder::Command *>(p))
+                c->interrupt();
+        }
+        if (rc->interrupted.empty() || rc->escalating)
+            return;
+        rc->escalating = true;
+    }
+
+    // kill commands that ignored our request,
+    // finished ones are never touched, their pids may be reused already
+    std::thread([rc]
+    {
+        std::unique_lock lk(rc->m);
+        rc->cv.wait_for(lk, kill_timeout, [&rc] { return rc->interrupted.empty(); });
+        rc->escalating = false;
+        for (auto &[p, _] : rc->commands)
+        {
+            if (!rc->interrupted.contains(p))
+                continue;
+            if (auto c = dynamic_cast<builder::Command *>(p))
+                c->interrupt(true);
+        }
+    }).detach();
 }
 
 void ExecutionPlan::execute(Executor &e) const
@@ -354,11 +144,21 @@ void ExecutionPlan::execute(Executor &e) const
     interrupted = false;
     std::atomic_int running = 0;
     std::atomic_int64_t askip_errors = skip_errors;
-    gcc_modules_server s{*this};
-    s.run();
 
     bool build_commands = dynamic_cast<builder::Command *>(*commands.begin());
 
+    // start shared module mapper server only when we have gcc module commands
+    std::vector<builder::Command *> mm_cmds;
+    if (build_commands)
+    {
+        for (auto &c : commands)
+        {
+            if (uses_module_mapper_server(*static_cast<builder::Command*>(c)))
+                mm_cmds.push_back(static_cast<builder::Command*>(c));
+        }
+    }
+    auto module_mapper_registration = ModuleMapperServer::get().registerCommands(mm_cmds);
+
     // set numbers
     std::atomic_size_t current_command = 1;
     std::atomic_size_t total_commands = commands.size();
@@ -376,22 +176,87 @@ void ExecutionPlan::execute(Executor &e) const
         //c->markForExecution();
     }
 
+    if (build_commands)
+        scan(e);
+
+    {
+        std::unique_lock lk(plans_m);
+        plans.insert(this);
+    }
+    SCOPE_EXIT
+    {
+        std::unique_lock lk(plans_m);
+        plans.erase(this);
+    };
+    // print everything before results or errors
+    SCOPE_EXIT
+    {
+        if (build_commands)
+            getBuildOutput().flush();
+    };
+
+    auto &rc = *running_commands;
+    // returns true if command was interrupted by us
+    auto finish = [&rc](T *c)
+    {
+        std::unique_lock lk(rc.m);
+        rc.commands.erase(c);
+        if (!rc.interrupted.erase(c))
+            return false;
+        if (rc.interrupted.empty())
+            rc.cv.notify_all();
+        return true;
+    };
+
+    // command records are not held between tasks,
+    // so workers keep one qsbr context for the whole run
+    ConcurrentContextBatch qsbr;
+
     std::function<void(PtrT)> run;
-    run = [this, &askip_errors, &e, &run, &fs, &all, &m, &running, &stopped](T *c)
+    run = [this, &askip_errors, &e, &run, &fs, &all, &m, &running, &stopped, &rc, &finish, &qsbr](T *c)
     {
+        qsbr.enter();
+        SCOPE_EXIT
+        {
+            qsbr.leave();
+        };
+        {
+            std::unique_lock lk(rc.m);
+            rc.commands.emplace(c, c->shared_from_this());
+        }
+        // check after registration, so stop() cannot miss us
         if (stopped || interrupted)
+        {
+            finish(c);
             return;
+        }
         try
         {
             running++;
             c->execute();
             running--;
+            finish(c);
         }
         catch (...)
         {
             running--;
+            if (finish(c))
+            {
+                // not an error, remove partial outputs
+                if (auto c2 = dynamic_cast<builder::Command *>(c))
+                {
+                    std::error_code ec;
+                    for (auto &o : c2->outputs)
+                        fs::remove(o, ec);
+                }
+                return;
+            }
             if (--askip_errors < 1)
+            {
                 stopped = true;
+                // free machine immediately, do not wait for running commands
+                interruptRunningCommands();
+            }
             if (throw_on_errors)
                 throw; // don't go futher on DAG by default
         }
@@ -476,6 +341,102 @@ void ExecutionPlan::execute(Executor &e) const
     }
 }
 
+// stat all plan files in parallel, then mark up to date commands,
+// so workers do not discover staleness one file at a time
+void ExecutionPlan::scan(Executor &e) const
+{
+    ScopedConcurrentContext qsbr;
+    auto t0 = Clock::now();
+
+    std::vector<FileId> ids;
+    for (auto &c : commands)
+        static_cast<builder::Command*>(c)->getFilesToCheck(ids);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    static_cast<builder::Command*>(*commands.begin())->getContext().getFileStorage().refresh(ids, e);
+
+    auto t1 = Clock::now();
+
+    // commands are sorted for execution, not topologically,
+    // so check them in dependency waves, deps first, each wave in parallel
+    // command with outdated dependency is checked at runtime as usual
+    std::unordered_map<T *, size_t> left;
+    left.reserve(commands.size());
+    VecT wave;
+    for (auto &c : commands)
+    {
+        left[c] = c->dependencies.size();
+        if (c->dependencies.empty())
+            wave.push_back(c);
+    }
+    ConcurrentContextBatch workers_qsbr;
+    std::atomic_size_t n = 0;
+    while (!wave.empty())
+    {
+        VecT check;
+        for (auto &c : wave)
+        {
+            auto c2 = static_cast<builder::Command*>(c);
+            c2->up_to_date = false;
+            if (c2->always || !c2->command_storage)
+                continue;
+            if (!std::all_of(c->dependencies.begin(), c->dependencies.end(), [](const auto &d)
+                { return static_cast<builder::Command*>(d.get())->up_to_date; }))
+                continue;
+            check.push_back(c);
+        }
+
+        const size_t chunk = std::max<size_t>(16, check.size() / (e.numberOfThreads() * 4) + 1);
+        std::vector<Future<void>> fs;
+        for (size_t i = 0; i < check.size(); i += chunk)
+        {
+            fs.push_back(e.push([&check, &n, &workers_qsbr, i, chunk]
+            {
+                workers_qsbr.enter();
+                SCOPE_EXIT
+                {
+                    workers_qsbr.leave();
+                };
+                auto end = std::min(i + chunk, check.size());
+                for (auto j = i; j < end; j++)
+                {
+                    auto c2 = static_cast<builder::Command*>(check[j]);
+                    try
+                    {
+                        c2->up_to_date = !c2->isOutdated();
+                    }
+                    catch (std::exception &)
+                    {
+                        // will be reported on execution
+                        continue;
+                    }
+                    n += c2->up_to_date;
+                }
+            }));
+        }
+        // also orders up_to_date writes before the next wave reads them
+        waitAndGet(fs);
+
+        VecT next;
+        for (auto &c : wave)
+        {
+            for (auto &d : c->dependent_commands)
+            {
+                auto i = left.find((T *)d.get());
+                if (i != left.end() && --i->second == 0)
+                    next.push_back(i->first);
+            }
+        }
+        wave = std::move(next);
+    }
+
+    auto t2 = Clock::now();
+    LOG_DEBUG(logger, "scanned " << ids.size() << " files in "
+        << std::chrono::duration_cast<std::chrono::duration<float>>(t1 - t0).count() << " s., "
+        << n << "/" << commands.size() << " commands are up to date ("
+        << std::chrono::duration_cast<std::chrono::duration<float>>(t2 - t1).count() << " s.)");
+}
+
 void ExecutionPlan::saveChromeTrace(const path &p) const
 {
     // calculate minimal time
@@ -656,37 +617,97 @@ ExecutionPlan::Graph ExecutionPlan::getGraph(const VecT &v, GraphMapping &gm)
     return g;
 }
 
-void ExecutionPlan::transitiveReduction()
+// commands must be in topological order (deps first)
+// reachability is calculated for blocks of commands at once,
+// so memory is bounded by n * block size bits
+size_t ExecutionPlan::transitiveReduction()
 {
-    auto gm = getGraphMapping(commands);
-    auto g = getGraph(commands, gm);
-
-    auto[tr, vm] = transitiveReduction(g);
+    const auto n = commands.size();
+    if (n < 3)
+        return 0;
+
+    GraphMapping pos;
+    pos.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        pos[commands[i]] = i;
+
+    // deps as positions, deps outside of plan are left untouched
+    std::vector<std::vector<size_t>> deps(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (auto &d : commands[i]->dependencies)
+        {
+            if (auto it = pos.find((T *)d.get()); it != pos.end())
+                deps[i].push_back(it->second);
+        }
+    }
 
-    // copy props
-    for (auto &[from, to] : vm)
-        tr.m_vertices[to].m_property = g.m_vertices[from].m_property;
+    // words per block, limit memory to ~32 MB
+    const size_t max_words = (n + 63) / 64;
+    const size_t words = std::clamp<size_t>((32 << 20) / 8 / n, 1, max_words);
+    const size_t block = words * 64;
 
-    // make new edges (dependencies)
-    for (auto &[from, to] : vm)
+    std::vector<uint64_t> reach(n * words);
+    std::vector<uint64_t> u(words);
+    std::vector<std::vector<size_t>> redundant(n);
+    for (size_t lo = 0; lo < n; lo += block)
     {
-        auto c = commands[from];
-        c->dependencies.clear();
-        for (auto &e : tr.m_vertices[to].m_out_edges)
-            c->dependencies.insert(tr.m_vertices[e.m_target].m_property->shared_from_this());
-    }
-}
+        const auto hi = std::min(n, lo + block);
+        auto r = [&](size_t v) { return reach.data() + v * words; };
+        auto in_block = [lo, hi](size_t v) { return v >= lo && v < hi; };
 
-std::tuple<ExecutionPlan::Graph, ExecutionPlan::VertexMap> ExecutionPlan::transitiveReduction(const Graph &g)
-{
-    Graph tr;
-    VertexMap vm;
+        // commands before the block cannot reach it
+        std::fill(reach.begin() + lo * words, reach.end(), 0);
+        for (size_t v = lo; v < n; v++)
+        {
+            auto rv = r(v);
+            for (auto d : deps[v])
+            {
+                if (d < lo)
+                    continue;
+                auto rd = r(d);
+                for (size_t w = 0; w < words; w++)
+                    rv[w] |= rd[w];
+                if (in_block(d))
+                    rv[(d - lo) / 64] |= 1ull << ((d - lo) % 64);
+            }
+        }
 
-    std::vector<size_t> id_map(boost::num_vertices(g));
-    std::iota(id_map.begin(), id_map.end(), 0u);
+        // direct dep is redundant if it is reachable through another dep
+        for (size_t v = lo; v < n; v++)
+        {
+            if (deps[v].size() < 2)
+                continue;
+            std::fill(u.begin(), u.end(), 0);
+            for (auto d : deps[v])
+            {
+                if (d < lo)
+                    continue;
+                auto rd = r(d);
+                for (size_t w = 0; w < words; w++)
+                    u[w] |= rd[w];
+            }
+            for (auto d : deps[v])
+            {
+                if (in_block(d) && (u[(d - lo) / 64] & (1ull << ((d - lo) % 64))))
+                    redundant[v].push_back(d);
+            }
+        }
+    }
 
-    boost::transitive_reduction(g, tr, boost::make_assoc_property_map(vm), id_map.data());
-    return { tr, vm };
+    size_t removed = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        auto c = commands[i];
+        for (auto d : redundant[i])
+        {
+            // keep dependent commands consistent with dependencies_left
+            commands[d]->dependent_commands.erase(c->shared_from_this());
+            c->dependencies.erase(commands[d]->shared_from_this());
+            removed++;
+        }
+    }
+    return removed;
 }
 
 void ExecutionPlan::prepare(USet &cmds)
@@ -785,7 +806,7 @@ void ExecutionPlan::prepare(USet &cmds)
     }
 }
 
-void ExecutionPlan::init(USet &cmds)
+void ExecutionPlan::init(USet &cmds, bool transitive_reduction)
 {
     while (!cmds.empty())
     {
@@ -816,11 +837,21 @@ void ExecutionPlan::init(USet &cmds)
 
     // setup
 
-    // potentially *should* speedup later execution
-    // TODO: measure and decide
-    // it reduses some memory usage,
-    // but influence on performance on execution stages is not very clear
-    //transitiveReduction();
+    for (auto &c : commands)
+        stats.edges += c->dependencies.size();
+
+    // consumers get an edge to every producer of every input,
+    // so drop edges implied by other paths
+    // this lowers memory usage and dependencies_left traffic during execution,
+    // but costs O(n * E / 64), so it is optional
+    if (transitive_reduction)
+    {
+        auto t0 = Clock::now();
+        stats.removed_edges = transitiveReduction();
+        stats.transitive_reduction_time = Clock::now() - t0;
+        LOG_DEBUG(logger, "transitive reduction: " << stats.edges << " -> " << stats.edges - stats.removed_edges << " edges ("
+            << std::chrono::duration_cast<std::chrono::duration<float>>(stats.transitive_reduction_time).count() << " s.)");
+    }
 
     // set number of deps and dependent commands
     for (auto &c : commands)
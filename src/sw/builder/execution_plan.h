@@ -20,12 +20,10 @@
 
 #include "command.h"
 
-#include <iso646.h> // for #include <boost/graph/transitive_reduction.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/strong_components.hpp>
-#include <boost/graph/transitive_reduction.hpp>
-#include <boost/graph/graph_utility.hpp> // dumping graphs
+#include <boost/graph/graph_utility.hpp> // dumping graphs
 #include <boost/graph/graphviz.hpp>      // generating pictures
 
 #include <chrono>
@@ -63,7 +61,16 @@ public:
     bool show_output = false;
     bool write_output_to_file = false;
 
-    ExecutionPlan(USet &cmds);
+    struct Stats
+    {
+        size_t edges = 0;
+        /// removed by transitive reduction
+        size_t removed_edges = 0;
+        Clock::duration transitive_reduction_time{};
+    };
+
+    /// transitive_reduction - drop dependency edges implied by other paths
+    ExecutionPlan(USet &cmds, bool transitive_reduction = false);
     ExecutionPlan(const ExecutionPlan &rhs) = delete;
     ExecutionPlan(ExecutionPlan &&) = default;
     ~ExecutionPlan();
@@ -72,10 +79,13 @@ public:
     void execute(Executor &e) const;
 
     // external request to stop execution
-    // running commands will be finished
-    // TODO: break running commands too
+    // running commands will be finished unless interrupt_running_commands is set
     void stop(bool interrupt_running_commands = false);
 
+    /// stops all executing plans and interrupts their commands (e.g., on ctrl-c)
+    /// returns false if nothing was executed
+    static bool interruptAll();
+
     // functions for builder::Command's
     static Commands load(const path &, const SwBuilderContext &, int type = 0);
     void save(const path &, int type = 0) const;
@@ -88,6 +98,9 @@ public:
     const USet &getUnprocessedCommandsSet() const { return unprocessed_commands_set; }
 
     bool isValid() const;
+    const Stats &getStats() const { return stats; }
+    /// number of dependency edges removed by transitive reduction
+    size_t getNumberOfRemovedEdges() const { return stats.removed_edges; }
 
     Graph getGraph() const;
     Graph getGraphUnprocessed() const;
@@ -103,7 +116,7 @@ public:
     static void printGraph(const G &g, const path &base, const VecT &names = {}, bool mangle_names = false);
 
     template <class T>
-    static std::unique_ptr<ExecutionPlan> create(const std::unordered_set<T> &in)
+    static std::unique_ptr<ExecutionPlan> create(const std::unordered_set<T> &in, bool transitive_reduction = false)
     {
         USet cmds;
         cmds.reserve(in.size());
@@ -111,27 +124,29 @@ public:
             cmds.insert(c.get());
 
         prepare(cmds);
-        return std::make_unique<ExecutionPlan>(cmds);
+        return std::make_unique<ExecutionPlan>(cmds, transitive_reduction);
     }
 
 private:
-    using Vertex = typename boost::graph_traits<Graph>::vertex_descriptor;
-    using VertexMap = std::unordered_map<Vertex, Vertex>;
+    struct RunningCommands;
 
     VecT commands;
     VecT unprocessed_commands;
     USet unprocessed_commands_set;
     mutable std::atomic_bool interrupted;
+    std::shared_ptr<RunningCommands> running_commands;
+    Stats stats;
 
     //
     std::optional<Clock::time_point> stop_time;
 
     static GraphMapping getGraphMapping(const VecT &v);
     static Graph getGraph(const VecT &v, GraphMapping &gm);
-    void transitiveReduction();
-    static std::tuple<Graph, VertexMap> transitiveReduction(const Graph &g);
+    size_t transitiveReduction();
     static void prepare(USet &cmds);
-    void init(USet &cmds);
+    void init(USet &cmds, bool transitive_reduction);
+    void scan(Executor &) const;
+    void interruptRunningCommands() const;
 };
 
 extern template SW_BUILDER_API void ExecutionPlan::printGraph(const ExecutionPlan::Graph &, const path &base, const ExecutionPlan::VecT &, bool);
@@ -0,0 +1,329 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "explain.h"
+
+#include "output.h"
+
+#include <sw/support/filesystem.h>
+
+#include <primitives/exceptions.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "explain");
+
+#define EXPLAIN_MAGIC "SWEX"
+#define EXPLAIN_VERSION 1
+#define EXPLAIN_MAX_FILES 10
+
+namespace sw
+{
+
+namespace
+{
+
+enum class EntryType : uint8_t
+{
+    String,
+    Record,
+    Output,
+};
+
+struct Writer
+{
+    std::ofstream o;
+    std::unordered_map<String, size_t> ids;
+
+    Writer(const path &fn)
+        : o(fn, std::ios::binary)
+    {
+        if (!o)
+            throw SW_RUNTIME_ERROR("Cannot open file: " + to_string(fn));
+        o << EXPLAIN_MAGIC;
+        o.put(EXPLAIN_VERSION);
+    }
+
+    void write(uint64_t v)
+    {
+        do
+        {
+            uint8_t b = v & 0x7f;
+            v >>= 7;
+            o.put(v ? b | 0x80 : b);
+        } while (v);
+    }
+
+    size_t getId(const String &s)
+    {
+        if (s.empty())
+            return 0;
+        auto [i, inserted] = ids.emplace(s, ids.size() + 1);
+        if (inserted)
+        {
+            o.put((char)EntryType::String);
+            write(s.size());
+            o.write(s.data(), s.size());
+        }
+        return i->second;
+    }
+
+    // fields are separated by zeros, see ExplainDatabase::write()
+    void add(const String &text)
+    {
+        Strings fields;
+        size_t p = 1, e;
+        while ((e = text.find('\0', p)) != text.npos)
+        {
+            fields.push_back(text.substr(p, e - p));
+            p = e + 1;
+        }
+        fields.push_back(text.substr(p));
+
+        auto type = (EntryType)text[0];
+
+        // strings go before entry
+        std::vector<size_t> field_ids;
+        for (size_t i = type == EntryType::Record ? 2 : 1; i < fields.size(); i++)
+            field_ids.push_back(getId(fields[i]));
+
+        o.put((char)type);
+        write(std::stoull(fields[0]));
+        if (type == EntryType::Record)
+            o.put((char)std::stoi(fields[1]));
+        for (auto id : field_ids)
+            write(id);
+    }
+};
+
+struct Reader
+{
+    std::ifstream i;
+    path fn;
+
+    Reader(const path &fn)
+        : i(fn, std::ios::binary), fn(fn)
+    {
+        if (!i)
+            throw SW_RUNTIME_ERROR("Cannot open file: " + to_string(fn));
+        char magic[sizeof(EXPLAIN_MAGIC) - 1];
+        if (!i.read(magic, sizeof(magic)) || memcmp(magic, EXPLAIN_MAGIC, sizeof(magic)) != 0)
+            throw SW_RUNTIME_ERROR("Not an explain database: " + to_string(fn));
+        if (i.get() != EXPLAIN_VERSION)
+            throw SW_RUNTIME_ERROR("Unsupported explain database version: " + to_string(fn));
+    }
+
+    uint64_t read()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            auto b = i.get();
+            if (b == EOF)
+                throw SW_RUNTIME_ERROR("Unexpected end of file: " + to_string(fn));
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        throw SW_RUNTIME_ERROR("Bad number in file: " + to_string(fn));
+    }
+};
+
+}
+
+static String make_entry(EntryType type, const Strings &fields)
+{
+    String s(1, (char)type);
+    for (auto &f : fields)
+    {
+        s += f;
+        s += '\0';
+    }
+    s.resize(s.size() - 1);
+    return s;
+}
+
+static void remove_old_databases(const path &dir)
+{
+    std::vector<path> files;
+    for (auto &f : fs::directory_iterator(dir))
+        files.push_back(f.path());
+    if (files.size() < EXPLAIN_MAX_FILES)
+        return;
+    // names are sortable by time
+    std::sort(files.begin(), files.end());
+    error_code ec;
+    for (size_t i = 0; i <= files.size() - EXPLAIN_MAX_FILES; i++)
+        fs::remove(files[i], ec);
+}
+
+static OutputChannel &get_channel()
+{
+    static OutputChannel o([]() -> OutputChannel::Writer
+    {
+        auto dir = ExplainDatabase::getDir();
+        fs::create_directories(dir);
+        remove_old_databases(dir);
+
+        char buf[32];
+        auto t = std::time(nullptr);
+        std::strftime(buf, sizeof(buf), "%Y%m%d-%H%M%S", std::localtime(&t));
+        // zero padded counter keeps names of the same second sortable
+        path fn;
+        for (int i = 0; fn.empty() || fs::exists(fn); i++)
+        {
+            char n[16];
+            std::snprintf(n, sizeof(n), "-%04d", i);
+            fn = dir / (buf + String(n) + ".swex");
+        }
+        LOG_TRACE(logger, "Writing explain database: " + to_string(fn));
+
+        auto w = std::make_shared<Writer>(fn);
+        return [w](const OutputRecords &records, bool)
+        {
+            for (auto &r : records)
+                w->add(r.text);
+            w->o.flush();
+        };
+    }());
+    return o;
+}
+
+String toString(ExplainReason r)
+{
+    switch (r)
+    {
+    case ExplainReason::NewCommand:
+        return "new command";
+    case ExplainReason::ArgumentsChanged:
+        return "arguments changed";
+    case ExplainReason::InputChanged:
+        return "input changed";
+    case ExplainReason::OutputMissing:
+        return "output missing";
+    case ExplainReason::OutputChanged:
+        return "output changed";
+    case ExplainReason::ImplicitInputChanged:
+        return "implicit input changed";
+    case ExplainReason::Always:
+        return "always build";
+    case ExplainReason::NoCommandStorage:
+        return "command storage is disabled";
+    }
+    return "unknown";
+}
+
+void ExplainDatabase::write(const ExplainRecord &r)
+{
+    get_channel().write(make_entry(EntryType::Record, {
+        std::to_string(r.hash), std::to_string((int)r.reason), r.name,
+        to_string(normalize_path(r.file)), r.old_value, r.new_value }));
+}
+
+void ExplainDatabase::writeOutputs(size_t hash, const Files &outputs)
+{
+    for (auto &o : outputs)
+        get_channel().write(make_entry(EntryType::Output, { std::to_string(hash), to_string(normalize_path(o)) }));
+}
+
+path ExplainDatabase::getDir()
+{
+    return fs::current_path() / SW_BINARY_DIR / "misc" / "explain";
+}
+
+path ExplainDatabase::getLatest()
+{
+    auto dir = getDir();
+    if (!fs::exists(dir))
+        return {};
+    path latest;
+    for (auto &f : fs::directory_iterator(dir))
+    {
+        if (f.path().extension() == ".swex" && (latest.empty() || latest < f.path()))
+            latest = f.path();
+    }
+    return latest;
+}
+
+ExplainDatabase ExplainDatabase::load(const path &fn)
+{
+    Reader r(fn);
+    Strings strings{ String{} };
+    auto get_string = [&strings, &fn](uint64_t id) -> const String &
+    {
+        if (id >= strings.size())
+            throw SW_RUNTIME_ERROR("Bad string id in file: " + to_string(fn));
+        return strings[id];
+    };
+
+    ExplainDatabase db;
+    int c;
+    try
+    {
+        while ((c = r.i.get()) != EOF)
+        {
+            switch ((EntryType)c)
+            {
+            case EntryType::String:
+            {
+                String s(r.read(), 0);
+                if (!r.i.read(s.data(), s.size()))
+                    throw SW_RUNTIME_ERROR("Unexpected end of file: " + to_string(fn));
+                strings.push_back(std::move(s));
+                break;
+            }
+            case EntryType::Record:
+            {
+                ExplainRecord rec;
+                rec.hash = r.read();
+                auto reason = r.i.get();
+                if (reason == EOF || reason > (int)ExplainReason::NoCommandStorage)
+                    throw SW_RUNTIME_ERROR("Bad record in file: " + to_string(fn));
+                rec.reason = (ExplainReason)reason;
+                rec.name = get_string(r.read());
+                rec.file = get_string(r.read());
+                rec.old_value = get_string(r.read());
+                rec.new_value = get_string(r.read());
+                db.records.push_back(std::move(rec));
+                break;
+            }
+            case EntryType::Output:
+            {
+                auto h = r.read();
+                db.outputs[h].insert(get_string(r.read()));
+                break;
+            }
+            default:
+                throw SW_RUNTIME_ERROR("Bad entry in file: " + to_string(fn));
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        // last entries of interrupted build may be partial
+        LOG_WARN(logger, e.what());
+    }
+    return db;
+}
+
+} // namespace sw
@@ -0,0 +1,74 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <primitives/filesystem.h>
+
+#include <unordered_map>
+
+namespace sw
+{
+
+enum class ExplainReason : uint8_t
+{
+    NewCommand,
+    ArgumentsChanged, // new command hash, but its outputs exist
+    InputChanged,
+    OutputMissing,
+    OutputChanged,
+    ImplicitInputChanged,
+    Always,
+    NoCommandStorage,
+};
+
+SW_BUILDER_API String toString(ExplainReason);
+
+struct ExplainRecord
+{
+    size_t hash = 0; // command
+    ExplainReason reason = ExplainReason::NewCommand;
+    String name; // command
+    path file; // triggering file
+    String old_value;
+    String new_value;
+};
+
+/// Why commands were outdated, one compact file per build.
+///
+/// File is written in the background.
+/// Format: "SWEX", version byte, then entries. Numbers are varints,
+/// strings are ids of previously written strings (0 is empty string).
+///  0 <size> <bytes>                      - string, ids start from 1
+///  1 <hash> <reason> <name> <file> <old> <new> - record
+///  2 <hash> <file>                       - output of outdated command
+struct SW_BUILDER_API ExplainDatabase
+{
+    std::vector<ExplainRecord> records;
+    std::unordered_map<size_t, Files> outputs; // command hash -> outputs
+
+    static void write(const ExplainRecord &);
+    static void writeOutputs(size_t hash, const Files &);
+
+    static path getDir();
+    /// latest database or empty path
+    static path getLatest();
+    static ExplainDatabase load(const path &fn);
+};
+
+} // namespace sw
@@ -20,13 +20,18 @@
 
 #include "command.h"
 #include "file_storage.h"
+#include "output.h"
 
 #include <sw/manager/settings.h>
 
-#include <primitives/executor.h>
-
+#include <array>
+#include <cerrno>
 #include <fstream>
-#include <sstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
 
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "file");
@@ -38,30 +43,26 @@ namespace sw
 
 void explainMessage(const String &subject, bool outdated, const String &reason, const String &name)
 {
-    static Executor explain_executor("explain executor", 1);
-    static std::ofstream o([]()
+    if (!outdated)
+        return;
+    static OutputChannel o([]()
     {
         fs::create_directories(path(SW_EXPLAIN_FILE).parent_path());
-        return SW_EXPLAIN_FILE;
-    }()); // goes first
-    explain_executor.push([=]
-    {
-        if (!outdated)
-            return;
-        auto print = [&subject, &name, &reason](auto &o)
+        return [f = std::make_shared<std::ofstream>(SW_EXPLAIN_FILE)](const OutputRecords &records, bool)
         {
-            o << subject << ": " << name << "\n";
-            o << "outdated\n";
-            o << "reason = " << reason << "\n" << std::endl;
+            String s;
+            for (auto &r : records)
+                s += r.text;
+            *f << s;
+            f->flush();
+            if (sw::Settings::get_user_settings().gExplainOutdatedToTrace)
+            {
+                for (auto &r : records)
+                    LOG_TRACE(logger, r.text);
+            }
         };
-        print(o);
-        if (sw::Settings::get_user_settings().gExplainOutdatedToTrace)
-        {
-            std::ostringstream ss;
-            print(ss);
-            LOG_TRACE(logger, ss.str());
-        }
-    });
+    }());
+    o.write(subject + ": " + name + "\n" + "outdated\n" + "reason = " + reason + "\n\n");
 }
 
 FileData::FileData(const FileData &rhs)
@@ -97,7 +98,17 @@ File::File(const path &p, FileStorage &fs)
 {
     if (file.empty())
         throw SW_RUNTIME_ERROR("Empty file");
-    data = &fs.registerFile(file);
+    id = fs.getFileId(file);
+    data = &fs.getFileData(id);
+    if (data->refreshed == FileData::RefreshType::Unrefreshed)
+        data->refresh(file);
+}
+
+File::File(FileId id, FileStorage &fs)
+    : file(fs.getFilePath(id)), data(&fs.getFileData(id)), id(id)
+{
+    if (data->refreshed == FileData::RefreshType::Unrefreshed)
+        data->refresh(file);
 }
 
 path File::getPath() const
@@ -115,6 +126,34 @@ const FileData &File::getFileData() const
     return *data;
 }
 
+// one syscall per file where possible
+static fs::file_type stat_file(const path &file, fs::file_time_type &t)
+{
+#if defined(__linux__) && defined(STATX_MTIME)
+    static std::atomic_bool has_statx = true;
+    if (has_statx)
+    {
+        struct statx stx;
+        if (statx(AT_FDCWD, file.c_str(), AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_MTIME, &stx) == 0)
+        {
+            if (!S_ISREG(stx.stx_mode))
+                return S_ISDIR(stx.stx_mode) ? fs::file_type::directory : fs::file_type::unknown;
+            auto d = std::chrono::seconds(stx.stx_mtime.tv_sec) + std::chrono::nanoseconds(stx.stx_mtime.tv_nsec);
+            t = std::chrono::file_clock::from_sys(std::chrono::sys_time<std::chrono::nanoseconds>(d));
+            return fs::file_type::regular;
+        }
+        if (errno == ENOENT || errno == ENOTDIR)
+            return fs::file_type::not_found;
+        if (errno == ENOSYS)
+            has_statx = false; // old kernel
+    }
+#endif
+    auto s = fs::status(file);
+    if (s.type() == fs::file_type::regular)
+        t = fs::last_write_time(file);
+    return s.type();
+}
+
 void FileData::refresh(const path &file)
 {
     FileData::RefreshType r = FileData::RefreshType::Unrefreshed;
@@ -122,10 +161,11 @@ void FileData::refresh(const path &file)
         return;
 
     bool changed = false;
-    auto s = fs::status(file);
-    if (s.type() != fs::file_type::regular)
+    fs::file_time_type t;
+    auto type = stat_file(file, t);
+    if (type != fs::file_type::regular)
     {
-        if (s.type() != fs::file_type::not_found)
+        if (type != fs::file_type::not_found)
             LOG_TRACE(logger, "checking for non-regular file: " << file);
         // we skip non regular files at the moment
         last_write_time = fs::file_time_type::min();
@@ -133,7 +173,6 @@ void FileData::refresh(const path &file)
     }
     else
     {
-        auto t = fs::last_write_time(file);
         if (t > last_write_time)
         {
             last_write_time = t;
@@ -167,18 +206,29 @@ std::optional<String> File::isChanged(const fs::file_time_type &in, bool throw_o
     return {};
 }
 
+// targets create their commands in parallel and may share files,
+// striped to keep FileData small
+static std::mutex &get_generator_mutex(const FileData *d)
+{
+    static std::array<std::mutex, 64> m;
+    return m[std::hash<const FileData *>()(d) % m.size()];
+}
+
 bool File::isGenerated() const
 {
+    std::unique_lock lk(get_generator_mutex(data));
     return !!data->generator.lock();
 }
 
 bool File::isGeneratedAtAll() const
 {
+    std::unique_lock lk(get_generator_mutex(data));
     return data->generated;
 }
 
 void File::setGenerated(bool g)
 {
+    std::unique_lock lk(get_generator_mutex(data));
     data->generated = g;
 }
 
@@ -187,6 +237,7 @@ void File::setGenerator(const std::shared_ptr<builder::Command> &g, bool ignore_
     if (!g)
         return;
 
+    std::unique_lock lk(get_generator_mutex(data));
     auto gold = data->generator.lock();
     auto same_command = gold && (gold != g &&
                                  !gold->isExecuted() &&
@@ -224,6 +275,7 @@ void File::setGenerator(const std::shared_ptr<builder::Command> &g, bool ignore_
 
 std::shared_ptr<builder::Command> File::getGenerator() const
 {
+    std::unique_lock lk(get_generator_mutex(data));
     return data->generator.lock();
 }
 
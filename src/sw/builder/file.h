@@ -38,6 +38,9 @@ struct Command;
 
 struct FileStorage;
 
+/// dense build-wide file id, see FileStorage
+using FileId = uint32_t;
+
 struct FileData
 {
     enum class RefreshType : uint8_t
@@ -77,6 +80,7 @@ struct SW_BUILDER_API File : virtual ICastable
 
     File() = default;
     File(const path &p, FileStorage &s);
+    File(FileId id, FileStorage &s);
     virtual ~File() = default;
 
     path getPath() const;
@@ -84,6 +88,7 @@ struct SW_BUILDER_API File : virtual ICastable
     FileData &getFileData();
     const FileData &getFileData() const;
 
+    FileId getId() const { return id; }
     bool empty() const { return file.empty(); }
 
     bool isChanged() const;
@@ -99,6 +104,7 @@ struct SW_BUILDER_API File : virtual ICastable
 
 private:
     mutable FileData *data = nullptr;
+    FileId id = 0;
 };
 
 #define EXPLAIN_OUTDATED(subject, outdated, reason, name) \
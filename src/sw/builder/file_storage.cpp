@@ -18,33 +18,139 @@
 
 #include "file_storage.h"
 
-#include "file.h"
 #include "sw_context.h"
 
+#include <primitives/exceptions.h>
+#include <primitives/executor.h>
+
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "file_storage");
 
 namespace sw
 {
 
+FileStorage::FileStorage()
+    : chunks(std::make_unique<std::atomic<Entry *>[]>(max_chunks))
+{
+    for (size_t i = 0; i < max_chunks; i++)
+        chunks[i] = nullptr;
+}
+
+FileStorage::~FileStorage()
+{
+    for (size_t i = 0; i < max_chunks; i++)
+        delete[] chunks[i].load();
+}
+
 void FileStorage::clear()
 {
-    files.clear();
+    // not thread safe
+    for (auto &s : shards)
+        s.ids.clear();
+    for (size_t i = 0; i < max_chunks; i++)
+        delete[] chunks[i].exchange(nullptr);
+    // ids may still be held by commands, so they are never reused
+    // new ids start from the next chunk, old ids point to removed chunks
+    next_id = ((next_id + chunk_size - 1) >> chunk_bits) << chunk_bits;
 }
 
 void FileStorage::reset()
 {
-    for (const auto &[k, f] : files)
-        f.reset();
+    for (size_t c = 0; c < max_chunks; c++)
+    {
+        auto p = chunks[c].load(std::memory_order_acquire);
+        if (!p)
+            continue;
+        for (size_t i = 0; i < chunk_size; i++)
+            p[i].data.reset();
+    }
+}
+
+FileStorage::Entry &FileStorage::getEntry(FileId id) const
+{
+    auto p = id < next_id ? chunks[id >> chunk_bits].load(std::memory_order_acquire) : nullptr;
+    if (!p)
+        throw SW_RUNTIME_ERROR("Bad file id: " + std::to_string(id));
+    return p[id & (chunk_size - 1)];
+}
+
+FileStorage::Entry &FileStorage::allocateEntry(FileId id)
+{
+    auto c = id >> chunk_bits;
+    if (c >= max_chunks)
+        throw SW_RUNTIME_ERROR("Too many files in file storage");
+    auto p = chunks[c].load(std::memory_order_acquire);
+    if (!p)
+    {
+        std::unique_lock lk(chunks_mutex);
+        p = chunks[c].load(std::memory_order_acquire);
+        if (!p)
+        {
+            p = new Entry[chunk_size];
+            chunks[c].store(p, std::memory_order_release);
+        }
+    }
+    return p[id & (chunk_size - 1)];
 }
 
-FileData &FileStorage::registerFile(const path &in_f)
+FileId FileStorage::getFileId(const path &in_f)
 {
     auto p = normalize_path(in_f);
-    auto d = files.insert(p);
-    if (d.second)
-        d.first->refresh(in_f);
-    return *d.first;
+    auto &s = shards[std::hash<path>()(p) % n_shards];
+    {
+        std::shared_lock lk(s.m);
+        auto i = s.ids.find(p);
+        if (i != s.ids.end())
+            return i->second;
+    }
+    std::unique_lock lk(s.m);
+    auto i = s.ids.find(p);
+    if (i != s.ids.end())
+        return i->second;
+    // id is published to others only via map, after entry is ready
+    FileId id = next_id++;
+    allocateEntry(id).file = p;
+    s.ids.emplace(std::move(p), id);
+    return id;
+}
+
+FileData &FileStorage::registerFile(const path &f)
+{
+    auto &d = getFileData(getFileId(f));
+    if (d.refreshed == FileData::RefreshType::Unrefreshed)
+        d.refresh(f);
+    return d;
+}
+
+void FileStorage::refresh(const std::vector<FileId> &ids, Executor &e)
+{
+    // big chunks, stat is cheap
+    const size_t n = std::max<size_t>(256, ids.size() / (e.numberOfThreads() * 4) + 1);
+    std::vector<Future<void>> fs;
+    for (size_t i = 0; i < ids.size(); i += n)
+    {
+        fs.push_back(e.push([this, &ids, i, n]
+        {
+            auto end = std::min(i + n, ids.size());
+            for (auto j = i; j < end; j++)
+            {
+                auto &en = getEntry(ids[j]);
+                if (en.data.refreshed == FileData::RefreshType::Unrefreshed)
+                    en.data.refresh(en.file);
+            }
+        }));
+    }
+    waitAndGet(fs);
+}
+
+FileData &FileStorage::getFileData(FileId id) const
+{
+    return getEntry(id).data;
+}
+
+const path &FileStorage::getFilePath(FileId id) const
+{
+    return getEntry(id).file;
 }
 
 }
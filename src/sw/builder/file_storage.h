@@ -18,26 +18,72 @@
 
 #pragma once
 
-#include "concurrent_map.h"
+#include "file.h"
 
 #include <primitives/filesystem.h>
 
+struct Executor;
+
+#include <array>
+#include <shared_mutex>
+
 namespace sw
 {
 
-struct FileData;
 struct SwBuilderContext;
 
+/// Build-wide file table.
+/// Every normalized path gets dense id, file data lives in flat chunks,
+/// so lookups by id are just array accesses.
 struct SW_BUILDER_API FileStorage
 {
-    using FileDataHashMap = ConcurrentHashMap<path, FileData>;
-
-    FileDataHashMap files;
+    FileStorage();
+    FileStorage(const FileStorage &) = delete;
+    FileStorage &operator=(const FileStorage &) = delete;
+    ~FileStorage();
 
     void clear(); // remove?
     void reset(); // remove?
 
+    /// registers file without touching the filesystem
+    FileId getFileId(const path &f);
+    /// registers file and refreshes its data on first use
     FileData &registerFile(const path &f);
+
+    /// refreshes unrefreshed files in parallel
+    void refresh(const std::vector<FileId> &ids, Executor &);
+
+    FileData &getFileData(FileId id) const;
+    const path &getFilePath(FileId id) const;
+    /// upper bound of ids, not a number of files
+    size_t size() const { return next_id; }
+
+private:
+    static constexpr size_t chunk_bits = 12;
+    static constexpr size_t chunk_size = 1 << chunk_bits;
+    static constexpr size_t max_chunks = 1 << 16;
+    static constexpr size_t n_shards = 64;
+
+    struct Entry
+    {
+        path file;
+        FileData data;
+    };
+
+    struct Shard
+    {
+        mutable std::shared_mutex m;
+        std::unordered_map<path, FileId> ids;
+    };
+
+    std::array<Shard, n_shards> shards;
+    // never reallocated, so readers do not take locks
+    std::unique_ptr<std::atomic<Entry *>[]> chunks;
+    std::atomic<FileId> next_id{ 0 };
+    std::mutex chunks_mutex;
+
+    Entry &getEntry(FileId id) const;
+    Entry &allocateEntry(FileId id);
 };
 
 }
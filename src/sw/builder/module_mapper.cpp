@@ -0,0 +1,432 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "module_mapper.h"
+
+#include <sw/support/filesystem.h>
+
+// clang(win)+linux workaround
+#if defined(__linux__) && defined(__clang__)
+#define BOOST_ASIO_HAS_CO_AWAIT
+#define BOOST_ASIO_HAS_STD_COROUTINE
+#endif
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "module_mapper");
+
+namespace sw
+{
+
+uint16_t get_module_mapper_port() {
+    static const auto port = []() {
+        using tcp = boost::asio::ip::tcp;
+        boost::asio::io_context ctx;
+        tcp::acceptor acceptor(ctx, tcp::endpoint(tcp::v6(), 0));
+        return acceptor.local_endpoint().port();
+    }();
+    return port;
+}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+static const path &get_module_mapper_socket_dir() {
+    // one dir per process, sockets are removed on server shutdown
+    static const auto p = []() {
+        auto p = support::get_temp_filename("mm");
+        fs::create_directories(p);
+        return p;
+    }();
+    return p;
+}
+
+static path get_module_mapper_socket(ModuleMapperChannel c) {
+    return get_module_mapper_socket_dir() / std::to_string((int)c);
+}
+#endif
+
+String get_module_mapper_argument(ModuleMapperChannel c, const String &ident) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // '=' is a local domain socket in gcc mapper syntax
+    return "-fmodule-mapper==" + get_module_mapper_socket(c).string() + "?" + ident;
+#else
+    return "-fmodule-mapper=:::" + std::to_string(get_module_mapper_port() + (int)c) + "?" + ident;
+#endif
+}
+
+bool uses_module_mapper_server(const builder::Command &c) {
+    for (auto &a : c.arguments) {
+        auto s = a->toString();
+        if (s.starts_with("-fmodule-mapper=:") || s.starts_with("-fmodule-mapper=="))
+            return true;
+    }
+    return false;
+}
+
+struct ModuleMapperServer::Impl {
+    ModuleMapperServer &server;
+    boost::asio::io_context ctx_main;
+    boost::asio::io_context ctx_headers;
+    std::thread t_main;
+    std::thread t_headers;
+
+    ~Impl() {
+        ctx_main.stop();
+        ctx_headers.stop();
+        if (t_headers.joinable())
+            t_headers.join();
+        if (t_main.joinable())
+            t_main.join();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        std::error_code ec;
+        fs::remove_all(get_module_mapper_socket_dir(), ec);
+#endif
+    }
+    void run() {
+        // compile handling
+        listen(ctx_main, ModuleMapperChannel::Compile);
+        // scan handling
+        listen(ctx_main, ModuleMapperChannel::Scan);
+        // import header handling
+        listen(ctx_headers, ModuleMapperChannel::HeaderUnits);
+        t_main = std::thread{[this](){
+            try {
+                ctx_main.run();
+            } catch (...) {}
+        }};
+        t_headers = std::thread{[this](){
+            try {
+                ctx_headers.run();
+            } catch (...) {}
+        }};
+    }
+    void listen(auto &&ctx, ModuleMapperChannel c) {
+        bool scan = c != ModuleMapperChannel::Compile;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        using local = boost::asio::local::stream_protocol;
+        auto fn = get_module_mapper_socket(c);
+        std::error_code ec;
+        fs::remove(fn, ec);
+        boost::asio::co_spawn(ctx, accept(ctx, local::acceptor(ctx, local::endpoint(fn.string())), scan), boost::asio::detached);
+#else
+        using tcp = boost::asio::ip::tcp;
+        boost::asio::co_spawn(ctx, accept(ctx, tcp::acceptor(ctx, tcp::endpoint(tcp::v6(), get_module_mapper_port() + (int)c)), scan), boost::asio::detached);
+#endif
+    }
+    boost::asio::awaitable<void> accept(auto &&ctx, auto acceptor, bool scan) {
+        while (1) {
+            auto sock = co_await acceptor.async_accept(boost::asio::use_awaitable);
+            boost::asio::co_spawn(ctx, scan ? process_scan(std::move(sock)) : process2(std::move(sock)), boost::asio::detached);
+        }
+    }
+    boost::asio::awaitable<void> process2(auto socket) {
+        using namespace boost::asio;
+        auto reply = [&socket](auto &&line, std::string s) {
+            if (line.ends_with(';'))
+                s += " ;";
+            s += "\n";
+            return async_write(socket, buffer(s), use_awaitable);
+        };
+        struct data {
+            path out;
+            String source;
+            String export_module;
+            std::unordered_map<String, path> import_modules;
+            std::unordered_map<String, path> header_units;
+
+            ~data() {
+                if (!source.empty())
+                    write_file_module_mapper();
+            }
+            void write_file_module_mapper() {
+                std::ostringstream ss;
+                ss << "$root ." << "\n";
+                if (!export_module.empty())
+                    ss << export_module << " " << export_module << "\n";
+                auto print = [&ss](auto &&what) {
+                    for (auto &&[k,v] : what)
+                        ss << k << " " << v.string() << "\n";
+                };
+                print(import_modules);
+                print(header_units);
+                write_file(out.parent_path() / (out.stem().stem() += ".map"), ss.str());
+            }
+            void write() {
+                // follow msvc here
+                nlohmann::json j;
+                j["Version"] = "1.1";
+                auto &jd = j["Data"];
+                jd["Source"] = source;
+                jd["ProvidedModule"] = export_module;
+                for (auto &&[n,p] : import_modules) {
+                    nlohmann::json m;
+                    m["Name"] = n;
+                    m["BMI"] = p.u8string();
+                    jd["ImportedModules"].push_back(m);
+                }
+                for (auto &&[n,p] : header_units) {
+                    nlohmann::json m;
+                    m["Name"] = n;
+                    m["BMI"] = p.u8string();
+                    jd["ImportedHeaderUnits"].push_back(m);
+                }
+                write_file(out, j.dump());
+            }
+        } d;
+        while (1) {
+            std::string buf;
+            co_await async_read_until(socket, dynamic_buffer(buf, 1024), "\n", use_awaitable);
+            auto lines = split_lines(buf);
+            for (auto &&line : lines) {
+                if (line.starts_with("HELLO")) {
+                    auto parts = split_string(line, " '"); // hello,ver,prog,ident,;
+                    auto parts2 = split_string(parts[3], ":");
+                    d.source = parts2[0];
+                    d.out = parts2[1];
+                    co_await reply(line, "HELLO 1 sw");
+                } else if (line.starts_with("MODULE-REPO")) {
+                    co_await reply(line, "PATHNAME .");
+                } else if (line.starts_with("MODULE-EXPORT")) {
+                    auto module = split_string(line, " ")[1]; // module,name
+                    d.export_module = module;
+                    co_await reply(line, "PATHNAME " + module + ".cmi");
+                } else if (line.starts_with("MODULE-IMPORT")) {
+                    auto module = split_string(line, " ")[1]; // module,name
+                    bool header = path{module}.is_absolute();
+                    if (header) {
+                        d.header_units[module] = d.out.parent_path() / "gcm.cache" / ("." + module + ".gcm");
+                    } else
+                        d.import_modules[module] = d.out.parent_path() / (module + ".cmi");
+                    d.write();
+                    if (header)
+                        co_await reply(line, "PATHNAME gcm.cache/." + module + ".gcm");
+                    else
+                        co_await reply(line, "PATHNAME " + module + ".cmi");
+                } else if (line.starts_with("MODULE-COMPILED")) {
+                    d.write();
+                    co_await reply(line, "OK"); // could be any string actually
+                } else {
+                    co_await reply(line, "ERROR 'Unknown command: " + line.substr(0, line.find(' ')) + "'");
+                    co_return;
+                }
+                /*
+                "INCLUDE-TRANSLATE"
+                "INVOKE"
+                */
+            }
+        }
+    }
+    boost::asio::awaitable<void> process_scan(auto socket) {
+        using namespace boost::asio;
+        auto reply = [&socket](auto &&line, std::string s) {
+            if (line.ends_with(';'))
+                s += " ;";
+            LOG_TRACE(logger, "socket " << socket.native_handle() << "< " << s);
+            s += "\n";
+            return async_write(socket, buffer(s), use_awaitable);
+        };
+        builder::Command *this_command{nullptr};
+        builder::Command::msvc_modules_scan_data d;
+        std::string module;
+        while (1) {
+            std::string buf;
+            co_await async_read_until(socket, dynamic_buffer(buf, 1024), "\n", use_awaitable);
+            auto lines = split_lines(buf);
+            std::string error;
+            try {
+                for (auto &&line : lines) {
+                    LOG_TRACE(logger, "socket " << socket.native_handle() << "> " << line);
+                    if (line.starts_with("HELLO")) {
+                        auto parts = split_string(line, " '"); // hello,ver,prog,ident,;
+                        auto parts2 = split_string(parts[3], ":");
+                        d.source = parts2[0];
+                        d.out = parts2[1];
+                        co_await reply(line, "HELLO 1 sw");
+                    } else if (line.starts_with("MODULE-REPO")) {
+                        co_await reply(line, "PATHNAME .");
+                    } else if (line.starts_with("MODULE-EXPORT")) {
+                        module = split_string(line, " ")[1]; // module,name
+                        bool header = path{module}.is_absolute();
+                        if (header) {
+                            d.export_module = module;
+                            d.write();
+                            co_await reply(line, "PATHNAME " + (d.out.parent_path() / d.out.stem().stem()).string() + ".gcm");
+                        }
+                        else {
+                            d.export_module = module;
+                            d.write();
+                            co_await reply(line, "PATHNAME " + module + ".cmi");
+                        }
+                    } else if (line.starts_with("MODULE-IMPORT")) {
+                        auto module = split_string(line, " ")[1]; // module,name
+                        bool header = path{module}.is_absolute();
+                        if (header) {
+                            d.header_units.push_back(module);
+                            // we create import header immediately
+                            auto fn = d.out.parent_path() / ("gcm.cache/." + module + ".gcm");
+                            if (!fs::exists(fn)) {
+                                if (!this_command) {
+                                    this_command = server.findCommand(d.out);
+                                    if (!this_command) {
+                                        co_await reply(line, "ERROR 'Cannot find according command for import header: " + module + "'");
+                                        co_return;
+                                    }
+                                }
+                                auto &from = *this_command;
+                                auto cmd = std::make_shared<builder::Command>(from.getContext());
+                                auto &c = *cmd;
+                                c.working_directory = from.working_directory;
+                                c.command_storage = from.command_storage;
+                                c.environment = from.environment;
+                                c.addOutput(fn);
+                                c.setProgram(from.arguments[0]->toString());
+                                for (int i = 0; auto &&a : from.arguments) {
+                                    if (i++) {
+                                        if (0
+                                            || a->toString().starts_with("-o")
+                                            )
+                                            continue;
+                                        if (a->toString().starts_with("-fmodule-mapper")) {
+                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(
+                                                get_module_mapper_argument(ModuleMapperChannel::HeaderUnits, module + ":"
+                                                + d.out.parent_path().string() + "/gcm.cache" + module + ".ifc.json")));
+                                            continue;
+                                        }
+                                        if (a->toString().starts_with("-E")) {
+                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>("-c"s));
+                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>("-xc++-header"s));
+                                            continue;
+                                        }
+                                        if (a->toString().starts_with("/"))
+                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(module));
+                                        else
+                                            c.arguments.push_back(std::make_unique<primitives::command::SimpleArgument>(a->toString()));
+                                        continue;
+                                    }
+                                }
+                                LOG_INFO(logger, "building import header: " << fn);
+                                LOG_TRACE(logger, "import header command: " << fn << "\n" << c.print());
+                                c.execute();
+                            }
+                        }
+                        else
+                            d.import_modules.push_back(module);
+                        d.write();
+                        if (header)
+                            co_await reply(line, "PATHNAME gcm.cache/." + module + ".gcm");
+                        else
+                            co_await reply(line, "PATHNAME " + module + ".cmi");
+                    } else if (line.starts_with("MODULE-COMPILED")) {
+                        co_await reply(line, "OK"); // could be any string actually
+                    } else if (line.starts_with("INCLUDE-TRANSLATE")) {
+                        co_await reply(line, "BOOL TRUE");
+                    } else {
+                        co_await reply(line, "ERROR 'Unknown command: " + line.substr(0, line.find(' ')) + "'");
+                        co_return;
+                    }
+                    /*
+                    ""
+                    "INVOKE"
+                    */
+                }
+            } catch (std::exception &e) {
+                LOG_ERROR(logger, "ERROR: " << e.what());
+                error = e.what();
+            }
+            if (!error.empty()) {
+                co_await reply(""s, "ERROR '"s + error + "'");
+                co_return;
+            }
+        }
+    }
+};
+
+ModuleMapperServer::Registration::Registration(Registration &&rhs) noexcept
+    : cmds(std::move(rhs.cmds))
+{
+    rhs.cmds.clear();
+}
+
+ModuleMapperServer::Registration::~Registration()
+{
+    if (!cmds.empty())
+        ModuleMapperServer::get().unregisterCommands(cmds);
+}
+
+ModuleMapperServer::ModuleMapperServer() = default;
+ModuleMapperServer::~ModuleMapperServer()
+{
+    // stop threads before routes are gone
+    impl.reset();
+}
+
+ModuleMapperServer &ModuleMapperServer::get()
+{
+    static ModuleMapperServer s;
+    return s;
+}
+
+void ModuleMapperServer::start()
+{
+    // under lock
+    if (running)
+        return;
+    LOG_TRACE(logger, "starting module mapper server");
+    impl = std::make_unique<Impl>(*this);
+    impl->run();
+    running = true;
+}
+
+ModuleMapperServer::Registration ModuleMapperServer::registerCommands(const std::vector<builder::Command *> &cmds)
+{
+    Registration r;
+    if (cmds.empty())
+        return r;
+    std::unique_lock lk(m);
+    start();
+    for (auto c : cmds)
+    {
+        for (auto &o : c->outputs)
+            routes[o] = c;
+    }
+    r.cmds = cmds;
+    return r;
+}
+
+void ModuleMapperServer::unregisterCommands(const std::vector<builder::Command *> &cmds)
+{
+    std::unique_lock lk(m);
+    for (auto c : cmds)
+    {
+        for (auto &o : c->outputs)
+        {
+            auto i = routes.find(o);
+            if (i != routes.end() && i->second == c)
+                routes.erase(i);
+        }
+    }
+}
+
+builder::Command *ModuleMapperServer::findCommand(const path &output) const
+{
+    std::unique_lock lk(m);
+    auto i = routes.find(output);
+    return i == routes.end() ? nullptr : i->second;
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "command.h"
+
+namespace sw
+{
+
+enum class ModuleMapperChannel
+{
+    Compile,
+    Scan,
+    HeaderUnits,
+};
+
+/// returns '-fmodule-mapper=...' argument for gcc
+/// on unix we use local domain sockets, tcp elsewhere
+SW_BUILDER_API
+String get_module_mapper_argument(ModuleMapperChannel, const String &ident);
+
+/// true if command talks to our module mapper server
+SW_BUILDER_API
+bool uses_module_mapper_server(const builder::Command &);
+
+/// One long-lived gcc module mapper server per process.
+/// Started lazily by the first execution plan that has module commands.
+/// Plans register their commands, so requests are routed by command outputs.
+struct SW_BUILDER_API ModuleMapperServer
+{
+    struct SW_BUILDER_API Registration
+    {
+        Registration() = default;
+        Registration(const Registration &) = delete;
+        Registration(Registration &&rhs) noexcept;
+        ~Registration();
+
+    private:
+        std::vector<builder::Command *> cmds;
+
+        friend struct ModuleMapperServer;
+    };
+
+    static ModuleMapperServer &get();
+
+    /// starts server if needed and registers commands for routing
+    [[nodiscard]]
+    Registration registerCommands(const std::vector<builder::Command *> &);
+    builder::Command *findCommand(const path &output) const;
+
+    bool isRunning() const { return running; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    std::atomic_bool running = false;
+    mutable std::mutex m;
+    std::unordered_map<path, builder::Command *> routes;
+
+    ModuleMapperServer();
+    ~ModuleMapperServer();
+
+    void start();
+    void unregisterCommands(const std::vector<builder::Command *> &);
+};
+
+}
@@ -28,11 +28,24 @@
 #include <windows.h>
 #endif
 
+#ifdef _WIN32
+#include <tlhelp32.h>
+#endif
+
 #if defined(CPPAN_OS_APPLE)
 #include <sys/types.h>
 #include <sys/sysctl.h>
+#include <libproc.h>
+#endif
+
+#ifndef _WIN32
+#include <signal.h>
 #endif
 
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "os");
 
@@ -515,4 +528,92 @@ String toString(ObjectFormatType e)
     throw SW_RUNTIME_ERROR("not implemented");
 }
 
+// parent -> children of all processes, one pass over the process table
+static std::unordered_multimap<int64_t, int64_t> get_process_children()
+{
+    std::unordered_multimap<int64_t, int64_t> children;
+#if defined(_WIN32)
+    auto h = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (h == INVALID_HANDLE_VALUE)
+        return children;
+    PROCESSENTRY32 e{};
+    e.dwSize = sizeof(e);
+    for (auto ok = Process32First(h, &e); ok; ok = Process32Next(h, &e))
+        children.emplace(e.th32ParentProcessID, e.th32ProcessID);
+    CloseHandle(h);
+#elif defined(__linux__)
+    error_code ec;
+    for (auto &d : fs::directory_iterator("/proc", ec))
+    {
+        auto n = d.path().filename().string();
+        if (n.empty() || !std::all_of(n.begin(), n.end(), [](char c) { return isdigit(c); }))
+            continue;
+        // pid (comm) state ppid ...
+        std::ifstream f(d.path() / "stat");
+        String stat;
+        std::getline(f, stat);
+        auto p = stat.rfind(')');
+        if (p == stat.npos)
+            continue;
+        std::istringstream ss(stat.substr(p + 1));
+        char state;
+        int64_t ppid;
+        if (ss >> state >> ppid)
+            children.emplace(ppid, std::stoll(n));
+    }
+#endif
+    return children;
+}
+
+// children are reparented when their parent dies,
+// so the whole tree is collected before any signal is sent
+static std::vector<int64_t> get_process_tree(int64_t pid)
+{
+    std::vector<int64_t> tree{ pid };
+#if defined(CPPAN_OS_APPLE)
+    for (size_t i = 0; i < tree.size(); i++)
+    {
+        std::vector<pid_t> pids(1024);
+        auto n = proc_listchildpids((pid_t)tree[i], pids.data(), (int)(pids.size() * sizeof(pid_t)));
+        for (int j = 0; j < n && j < (int)pids.size(); j++)
+            tree.push_back(pids[j]);
+    }
+#else
+    auto children = get_process_children();
+    for (size_t i = 0; i < tree.size(); i++)
+    {
+        auto [b, e] = children.equal_range(tree[i]);
+        for (auto c = b; c != e; c++)
+        {
+            // pids are reused, parent links may form a cycle (pid 0 on windows is its own parent)
+            if (std::find(tree.begin(), tree.end(), c->second) == tree.end())
+                tree.push_back(c->second);
+        }
+    }
+#endif
+    return tree;
+}
+
+bool terminate_process(int64_t pid, bool force)
+{
+    if (pid <= 0)
+        return false;
+    // compiler drivers spawn their own children
+    bool r = false;
+    for (auto p : get_process_tree(pid))
+    {
+#ifdef _WIN32
+        // console processes cannot be asked gracefully without own console group
+        auto h = OpenProcess(PROCESS_TERMINATE, FALSE, (DWORD)p);
+        if (!h)
+            continue;
+        r |= !!TerminateProcess(h, 1);
+        CloseHandle(h);
+#else
+        r |= kill((pid_t)p, force ? SIGKILL : SIGTERM) == 0;
+#endif
+    }
+    return r;
+}
+
 }
@@ -275,4 +275,9 @@ struct SW_BUILDER_API OS
 SW_BUILDER_API
 const OS &getHostOS();
 
+/// asks process and all its descendants to terminate
+/// force - kill immediately (unix)
+SW_BUILDER_API
+bool terminate_process(int64_t pid, bool force = false);
+
 }
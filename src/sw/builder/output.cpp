@@ -0,0 +1,288 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "output.h"
+
+#include <sw/manager/settings.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "output");
+
+namespace sw
+{
+
+// single producer (owner thread), single consumer (writer thread)
+struct OutputChannel::Buffer
+{
+    static constexpr size_t capacity = 1024;
+
+    std::array<OutputRecord, capacity> records;
+    std::atomic_size_t head = 0; // next to read
+    std::atomic_size_t tail = 0; // next to write
+
+    size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+};
+
+static std::atomic_size_t next_channel_id = 0;
+
+OutputChannel::OutputChannel(Writer w)
+    : writer(std::move(w)), id(next_channel_id++)
+{
+    t = std::thread([this] { run(); });
+}
+
+OutputChannel::~OutputChannel()
+{
+    {
+        std::unique_lock lk(m);
+        stopped = true;
+    }
+    cv.notify_one();
+    t.join();
+}
+
+OutputChannel::Buffer &OutputChannel::getBuffer()
+{
+    // channel id -> buffer of this thread
+    thread_local std::unordered_map<size_t, Buffer *> thread_buffers;
+    auto &b = thread_buffers[id];
+    if (!b)
+    {
+        std::unique_lock lk(m);
+        b = buffers.emplace_back(std::make_unique<Buffer>()).get();
+    }
+    return *b;
+}
+
+void OutputChannel::notify()
+{
+    {
+        std::unique_lock lk(m);
+        wakeup = true;
+    }
+    cv.notify_one();
+}
+
+void OutputChannel::push(OutputRecord r)
+{
+    auto &b = getBuffer();
+    auto tail = b.tail.load(std::memory_order_relaxed);
+    // full, wait for the writer
+    if (tail - b.head.load(std::memory_order_acquire) == Buffer::capacity)
+    {
+        std::unique_lock lk(m);
+        wakeup = true;
+        cv.notify_one();
+        cv_space.wait(lk, [&b, tail] { return tail - b.head.load(std::memory_order_acquire) < Buffer::capacity; });
+    }
+    r.n = n_records++;
+    b.records[tail % Buffer::capacity] = std::move(r);
+    b.tail.store(tail + 1, std::memory_order_release);
+    // do not wake writer on every record
+    if (tail - b.head.load(std::memory_order_relaxed) == Buffer::capacity / 2)
+        notify();
+}
+
+void OutputChannel::write(String text)
+{
+    push({ std::move(text) });
+}
+
+void OutputChannel::status(String text)
+{
+    push({ std::move(text), true });
+}
+
+void OutputChannel::flush()
+{
+    auto n = n_records.load();
+    std::unique_lock lk(m);
+    flush_requested = true;
+    wakeup = true;
+    cv.notify_one();
+    cv_written.wait(lk, [this, n] { return n_written >= n && !flush_requested; });
+}
+
+void OutputChannel::run()
+{
+    OutputRecords records;
+    std::vector<Buffer *> bufs;
+    while (1)
+    {
+        bool stop, flush;
+        {
+            std::unique_lock lk(m);
+            cv.wait_for(lk, std::chrono::milliseconds(50), [this] { return wakeup || stopped; });
+            wakeup = false;
+            stop = stopped;
+            flush = flush_requested;
+            bufs.clear();
+            for (auto &b : buffers)
+                bufs.push_back(b.get());
+        }
+
+        records.clear();
+        for (auto b : bufs)
+        {
+            auto head = b->head.load(std::memory_order_relaxed);
+            auto tail = b->tail.load(std::memory_order_acquire);
+            for (auto i = head; i < tail; i++)
+                records.push_back(std::move(b->records[i % Buffer::capacity]));
+            b->head.store(tail, std::memory_order_release);
+        }
+        std::sort(records.begin(), records.end(), [](const auto &a, const auto &b) { return a.n < b.n; });
+
+        if (!records.empty() || flush)
+        {
+            try
+            {
+                writer(records, flush);
+            }
+            catch (std::exception &e)
+            {
+                std::cerr << "output error: " << e.what() << "\n";
+            }
+        }
+
+        {
+            std::unique_lock lk(m);
+            n_written += records.size();
+            // records from producers that were still writing will come with the next round
+            if (flush && n_written >= n_records)
+                flush_requested = false;
+            else if (flush)
+                wakeup = true;
+        }
+        cv_written.notify_all();
+        cv_space.notify_all();
+
+        if (stop && std::all_of(bufs.begin(), bufs.end(), [](auto b) { return b->size() == 0; }))
+            break;
+    }
+}
+
+static bool is_terminal()
+{
+#ifdef _WIN32
+    return _isatty(_fileno(stdout));
+#else
+    return isatty(fileno(stdout));
+#endif
+}
+
+static size_t get_terminal_width()
+{
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi))
+        return csbi.srWindow.Right - csbi.srWindow.Left + 1;
+#else
+    winsize w;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col)
+        return w.ws_col;
+#endif
+    return 80;
+}
+
+static OutputChannel::Writer get_log_writer()
+{
+    return [](const OutputRecords &records, bool)
+    {
+        String s;
+        for (auto &r : records)
+            s += r.text + "\n";
+        if (s.empty())
+            return;
+        s.resize(s.size() - 1);
+        LOG_INFO(logger, s);
+    };
+}
+
+static OutputChannel::Writer get_status_line_writer()
+{
+    return [status = String{}](const OutputRecords &records, bool flush) mutable
+    {
+        auto clear = [&status]()
+        {
+            if (!status.empty())
+                std::cout << "\r\x1b[K" << std::flush;
+        };
+        String s;
+        auto write = [&s, &clear]()
+        {
+            if (s.empty())
+                return;
+            clear();
+            s.resize(s.size() - 1);
+            LOG_INFO(logger, s);
+            s.clear();
+        };
+        for (auto &r : records)
+        {
+            if (r.status)
+            {
+                // keep progress in logs, in order with outputs
+                write();
+                LOG_DEBUG(logger, r.text);
+                status = r.text;
+                continue;
+            }
+            s += r.text + "\n";
+        }
+        write();
+        if (status.empty())
+            return;
+        auto w = get_terminal_width();
+        auto line = status.size() < w ? status : status.substr(0, w - 1);
+        std::cout << "\r" << line << "\x1b[K";
+        if (flush)
+        {
+            // keep last line
+            std::cout << "\n";
+            status.clear();
+        }
+        std::cout << std::flush;
+    };
+}
+
+OutputChannel &getBuildOutput()
+{
+    static OutputChannel o([]()
+    {
+        if (Settings::get_user_settings().status_line && is_terminal())
+            return get_status_line_writer();
+        return get_log_writer();
+    }());
+    return o;
+}
+
+} // namespace sw
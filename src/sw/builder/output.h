@@ -0,0 +1,91 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <primitives/string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace sw
+{
+
+struct OutputRecord
+{
+    String text;
+    bool status = false; // progress, may be replaced by the next one
+    size_t n = 0;
+};
+
+using OutputRecords = std::vector<OutputRecord>;
+
+/// Output of many threads into single destination.
+///
+/// Each thread puts records into its own ring buffer without locking,
+/// one writer thread drains all buffers and passes records to the writer
+/// in batches ordered by record number.
+/// Records of one thread are never reordered, so progress line
+/// of a command always goes before its output.
+struct SW_BUILDER_API OutputChannel
+{
+    /// flush is true when called from flush(), records may be empty then
+    using Writer = std::function<void(const OutputRecords &, bool flush)>;
+
+    OutputChannel(Writer);
+    OutputChannel(const OutputChannel &) = delete;
+    OutputChannel &operator=(const OutputChannel &) = delete;
+    ~OutputChannel();
+
+    void write(String text);
+    void status(String text);
+
+    /// waits until all records written before are processed
+    void flush();
+
+private:
+    struct Buffer;
+
+    Writer writer;
+    size_t id;
+    std::atomic_size_t n_records = 0;
+    std::atomic_size_t n_written = 0;
+    std::mutex m;
+    std::condition_variable cv;
+    std::condition_variable cv_written;
+    std::condition_variable cv_space; // producers with full buffers wait here
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    bool wakeup = false;
+    bool flush_requested = false;
+    bool stopped = false;
+    std::thread t;
+
+    void push(OutputRecord);
+    Buffer &getBuffer();
+    void run();
+    void notify();
+};
+
+/// progress and outputs of commands
+/// on terminals progress goes into single status line
+SW_BUILDER_API OutputChannel &getBuildOutput();
+
+} // namespace sw
@@ -0,0 +1,137 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stage.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <sys/clonefile.h>
+#endif
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "stage");
+
+namespace sw
+{
+
+static bool reflink(const path &from, const path &to)
+{
+#if defined(__linux__) && defined(FICLONE)
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+    struct stat st;
+    if (fstat(in, &st) != 0)
+    {
+        close(in);
+        return false;
+    }
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+    if (out < 0)
+    {
+        close(in);
+        return false;
+    }
+    bool ok = ioctl(out, FICLONE, in) == 0;
+    close(out);
+    close(in);
+    if (!ok)
+        unlink(to.c_str());
+    return ok;
+#elif defined(__APPLE__)
+    return clonefile(from.c_str(), to.c_str(), 0) == 0;
+#else
+    // windows has block cloning only on ReFS, so go to hardlinks
+    return false;
+#endif
+}
+
+bool is_staged(const path &from, const path &to)
+{
+    std::error_code ec;
+    if (fs::equivalent(from, to, ec))
+        return true;
+    if (ec)
+        return false;
+    auto s1 = fs::file_size(from, ec);
+    if (ec)
+        return false;
+    auto s2 = fs::file_size(to, ec);
+    if (ec || s1 != s2)
+        return false;
+    auto t1 = fs::last_write_time(from, ec);
+    if (ec)
+        return false;
+    auto t2 = fs::last_write_time(to, ec);
+    return !ec && t1 == t2;
+}
+
+StageMethod stage_file(const path &from, const path &to, bool allow_symlink)
+{
+    if (is_staged(from, to))
+        return StageMethod::UpToDate;
+
+    fs::create_directories(to.parent_path());
+    std::error_code ec;
+    fs::remove(to, ec); // also breaks old hardlink
+
+    auto set_time = [&from, &to]()
+    {
+        std::error_code ec;
+        auto t = fs::last_write_time(from, ec);
+        if (!ec)
+            fs::last_write_time(to, t, ec);
+    };
+
+    if (reflink(from, to))
+    {
+        set_time();
+        LOG_TRACE(logger, "reflinked " << to);
+        return StageMethod::Reflink;
+    }
+
+    fs::create_hard_link(from, to, ec);
+    if (!ec)
+    {
+        LOG_TRACE(logger, "hardlinked " << to);
+        return StageMethod::Hardlink;
+    }
+
+    if (allow_symlink)
+    {
+        fs::create_symlink(from, to, ec);
+        if (!ec)
+        {
+            LOG_TRACE(logger, "symlinked " << to);
+            return StageMethod::Symlink;
+        }
+    }
+
+    fs::copy_file(from, to, fs::copy_options::overwrite_existing);
+    set_time();
+    LOG_TRACE(logger, "copied " << to);
+    return StageMethod::Copy;
+}
+
+}
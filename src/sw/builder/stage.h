@@ -0,0 +1,45 @@
+/*
+ * SW - Build System and Package Manager
+ * Copyright (C) 2017-2020 Egor Pugin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <primitives/filesystem.h>
+
+namespace sw
+{
+
+enum class StageMethod
+{
+    UpToDate,
+    Reflink,
+    Hardlink,
+    Symlink,
+    Copy,
+};
+
+/// true if 'to' is the same file as 'from' or has its size and mtime
+SW_BUILDER_API
+bool is_staged(const path &from, const path &to);
+
+/// Places 'from' at 'to' using the cheapest method available:
+/// reflink, hardlink, symlink (only when allowed), copy.
+/// Copies get mtime of the source, so is_staged() works for them too.
+SW_BUILDER_API
+StageMethod stage_file(const path &from, const path &to, bool allow_symlink = false);
+
+}
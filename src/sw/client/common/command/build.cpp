@@ -149,6 +149,13 @@ SUBCOMMAND_DECL(build)
         b->runSavedExecutionPlan();
         return;
     }
+    // ide fast path needs prepared targets
+    if (!getOptions().options_build.build_no_fast_path && getOptions().options_build.ide_fast_path.empty())
+    {
+        auto s = b->getSettings();
+        s["fast_path"] = "true";
+        b->setSettings(s);
+    }
     b->build();
 
     // handle ide_fast_path
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: AGPL-3.0-or-later
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#include "../commands.h"
+
+#include <sw/builder/explain.h>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "explain");
+
+using FileCounts = std::vector<std::pair<size_t, path>>;
+
+static void print_top(const String &title, const FileCounts &files, int top)
+{
+    if (files.empty())
+        return;
+    LOG_INFO(logger, title + ":");
+    for (size_t i = 0; i < std::min<size_t>(top, files.size()); i++)
+        LOG_INFO(logger, "  " << files[i].first << " commands: " << to_string(normalize_path(files[i].second)));
+}
+
+SUBCOMMAND_DECL(explain)
+{
+    auto &o = getOptions().options_explain;
+    auto fn = o.explain_file.empty() ? sw::ExplainDatabase::getLatest() : o.explain_file;
+    if (fn.empty())
+        throw SW_RUNTIME_ERROR("No explain database found, build with --explain-outdated first");
+    auto db = sw::ExplainDatabase::load(fn);
+
+    if (o.explain_list)
+    {
+        for (auto &r : db.records)
+        {
+            String s = r.name + " (" + std::to_string(r.hash) + "): " + sw::toString(r.reason);
+            if (!r.file.empty())
+                s += " " + to_string(normalize_path(r.file));
+            if (!r.old_value.empty() || !r.new_value.empty())
+                s += " [" + r.old_value + " -> " + r.new_value + "]";
+            LOG_INFO(logger, s);
+        }
+        LOG_INFO(logger, "");
+    }
+
+    // commands may be checked more than once, count them once
+    std::unordered_set<size_t> commands;
+    std::map<sw::ExplainReason, std::unordered_set<size_t>> reasons;
+    std::unordered_map<path, std::unordered_set<size_t>> files;
+    for (auto &r : db.records)
+    {
+        commands.insert(r.hash);
+        reasons[r.reason].insert(r.hash);
+        if (r.reason == sw::ExplainReason::InputChanged || r.reason == sw::ExplainReason::ImplicitInputChanged)
+            files[r.file].insert(r.hash);
+    }
+
+    LOG_INFO(logger, "Explain database: " << to_string(normalize_path(fn)));
+    LOG_INFO(logger, "Outdated commands: " << commands.size());
+    for (auto &[r, c] : reasons)
+        LOG_INFO(logger, "  " << sw::toString(r) << ": " << c.size());
+
+    // files changed by outdated commands are consequences,
+    // other changed files are root causes
+    std::unordered_set<path> generated;
+    for (auto &[h, outputs] : db.outputs)
+        generated.insert(outputs.begin(), outputs.end());
+
+    FileCounts roots, derived;
+    for (auto &[f, c] : files)
+        (generated.contains(f) ? derived : roots).emplace_back(c.size(), f);
+    auto sort = [](auto &v) { std::sort(v.begin(), v.end(), std::greater<>{}); };
+    sort(roots);
+    sort(derived);
+
+    print_top("Changed files (root causes)", roots, o.explain_top);
+    print_top("Rebuilt files", derived, o.explain_top);
+}
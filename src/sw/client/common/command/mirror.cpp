@@ -3,6 +3,143 @@
 
 #include "../commands.h"
 
+#include <nlohmann/json.hpp>
+#include <sw/manager/remote.h>
+#include <sw/manager/storage_remote.h>
+#include <sw/support/hash.h>
+#include <sw/support/storage.h>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "mirror");
+
+// mirror layout:
+//  static/specification.json - remote spec, all paths are relative to mirror root
+//  db/                       - packages index snapshot
+//  archives/ab/cd/<hash>     - content addressed source archives
+//
+// usage: add remote with 'file://<dir>' url
+
+static bool check_archive(const path &fn, const String &hash)
+{
+    return get_strong_file_hash(fn, hash) == hash || sw::support::get_file_hash(fn) == hash;
+}
+
+static sw::RemoteStorage &get_mirrored_storage(sw::SwContext &swctx, const String &name)
+{
+    for (auto s : swctx.getRemoteStorages())
+    {
+        auto rs = dynamic_cast<sw::RemoteStorage *>(s);
+        if (!rs)
+            continue;
+        if (name.empty() || rs->getRemote().name == name)
+            return *rs;
+    }
+    if (name.empty())
+        throw SW_RUNTIME_ERROR("No remotes available");
+    throw SW_RUNTIME_ERROR("Remote not found: " + name);
+}
+
+static sw::UnresolvedPackages read_lock_file(const path &fn)
+{
+    sw::UnresolvedPackages pkgs;
+    auto j = nlohmann::json::parse(read_file(fn));
+    for (auto &v : j["resolved_packages"].items())
+        pkgs.insert(sw::extractPackageIdFromString(v.value()["package"].get<String>()));
+    return pkgs;
+}
+
 SUBCOMMAND_DECL(mirror)
 {
+    auto &o = getOptions().options_mirror;
+    auto dir = fs::absolute(o.mirror_dir);
+
+    sw::UnresolvedPackages pkgs;
+    for (auto &p : o.mirror_args)
+        pkgs.insert(sw::extractFromString(p));
+    if (!o.mirror_lock_file.empty())
+        pkgs.merge(read_lock_file(o.mirror_lock_file));
+    if (pkgs.empty())
+        throw SW_RUNTIME_ERROR("No packages to mirror");
+
+    auto &rs = get_mirrored_storage(getContext(), o.mirror_remote);
+    error_code ec;
+    if (rs.getRemote().isLocal() && fs::equivalent(rs.getRemote().getLocalDir(), dir, ec))
+        throw SW_RUNTIME_ERROR("Cannot mirror remote into itself");
+    if (sw::readPackagesDatabaseVersion(rs.getRepositoryDir()) == 0)
+        throw SW_RUNTIME_ERROR("Packages index of " + rs.getRemote().name + " remote is not downloaded");
+
+    // closure
+    auto m = getContext().resolve(pkgs, std::vector<sw::IStorage *>{ &rs });
+
+    // same archive may be used by several versions, keep one copy
+    std::unordered_map<sw::PackageId, const sw::Package *> unique_pkgs;
+    for (auto &[u, p] : m)
+        unique_pkgs.emplace(*p, p.get());
+    std::map<String, const sw::Package *> archives;
+    for (auto &[id, p] : unique_pkgs)
+    {
+        auto h = p->getData().getHash(sw::StorageFileType::SourceArchive);
+        if (h.empty())
+            throw SW_RUNTIME_ERROR("Package has no archive hash: " + id.toString());
+        archives.emplace(h, p);
+    }
+
+    LOG_INFO(logger, "Mirroring " << unique_pkgs.size() << " packages (" << archives.size() << " archives) from "
+        << rs.getRemote().name << " remote into " << normalize_path(dir));
+
+    std::atomic_size_t n_downloaded = 0;
+    auto &e = *getContext().executor;
+    Futures<void> jobs;
+    for (auto &[h, p] : archives)
+    {
+        jobs.push_back(e.push([&rs, &dir, &n_downloaded, h = h, p = p]
+        {
+            auto dst = dir / "archives" / sw::getArchiveHashPath(h);
+            if (fs::exists(dst))
+            {
+                if (check_archive(dst, h))
+                    return;
+                LOG_WARN(logger, "Bad archive in mirror, replacing: " << normalize_path(dst));
+            }
+
+            LOG_INFO(logger, "Downloading: [" + p->toString() + "]");
+            fs::create_directories(dst.parent_path());
+            auto tmp = path(dst) += ".tmp";
+            SCOPE_EXIT
+            {
+                error_code ec;
+                fs::remove(tmp, ec);
+            };
+            // copy() verifies hash
+            if (!rs.getFile(*p, sw::StorageFileType::SourceArchive)->copy(tmp))
+                throw SW_RUNTIME_ERROR("Error downloading file for package: " + p->toString());
+            fs::rename(tmp, dst);
+            n_downloaded++;
+        }));
+    }
+    waitAndGet(jobs);
+
+    // index snapshot
+    // it is small, so we take the whole index, not only the closure
+    auto db_dir = dir / "db";
+    fs::create_directories(db_dir);
+    for (auto &f : fs::directory_iterator(rs.getRepositoryDir()))
+    {
+        if (f.is_directory())
+            continue;
+        fs::copy_file(f, db_dir / f.path().filename(), fs::copy_options::overwrite_existing);
+    }
+
+    nlohmann::json j;
+    auto &spec = j["specification"];
+    spec["database"]["local_dir"] = "db";
+    spec["database"]["version_root_url"] = "db";
+    nlohmann::json ds;
+    ds["mirror"]["url"] = "archives/{AHPF}";
+    spec["data_sources"].push_back(ds);
+    write_file(dir / "static" / "specification.json", j.dump(4));
+
+    LOG_INFO(logger, "Mirror is ready: " << n_downloaded << " archives downloaded, "
+        << archives.size() - n_downloaded << " archives reused");
+    LOG_INFO(logger, "Use it with remote url: file://" << to_string(normalize_path(dir)));
 }
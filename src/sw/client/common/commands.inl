@@ -27,6 +27,7 @@ SUBCOMMAND(build) COMMA
 SUBCOMMAND(configure) COMMA
 SUBCOMMAND(create) COMMA
 SUBCOMMAND(doc) COMMA // invokes documentation (hopefully)
+SUBCOMMAND(explain) COMMA
 SUBCOMMAND(generate) COMMA
 // rename to query?
 SUBCOMMAND(get) COMMA // returns different information
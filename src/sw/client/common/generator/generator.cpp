@@ -13,9 +13,12 @@
 
 #include <boost/algorithm/string.hpp>
 #include <nlohmann/json.hpp>
+#include <primitives/executor.h>
 #include <primitives/sw/cl.h>
 #include <primitives/pack.h>
 
+#include <fstream>
+
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "generator");
 
@@ -1286,26 +1289,81 @@ void ShellGenerator::generate(const SwBuild &b)
     write_file(getRootDirectory(b) / ("commands"s + (batch ? ".bat" : ".sh")), ctx.getText());
 }
 
+// one record of compile_commands.json, formatted as j.dump(2) does for array elements
+static String compdb_record(const builder::Command &c, bool compdb_clion, bool allow_empty_file_directive)
+{
+    nlohmann::json j2;
+    if (!c.working_directory.empty())
+        j2["directory"] = to_printable_string(normalize_path(c.working_directory));
+    if (!c.inputs.empty())
+    {
+        bool cppset = false;
+        for (auto &input : c.inputs)
+        {
+            auto i = exts.find(input.extension().string());
+            if (i == exts.end())
+                continue;
+            j2["file"] = to_printable_string(normalize_path(input));
+            cppset = true;
+            break;
+        }
+        if (!cppset)
+        {
+            for (auto &input : c.inputs)
+            {
+                if (normalize_path(input) != normalize_path(c.getProgram()))
+                {
+                    j2["file"] = to_printable_string(normalize_path(input));
+                    break;
+                }
+            }
+        }
+    }
+    if (allow_empty_file_directive && !j2.contains("file"))
+        j2["file"] = "";
+    for (auto &a : c.arguments)
+        j2["arguments"].push_back(a->toString());
+
+    // indent by one level
+    String r = "  ";
+    for (auto ch : j2.dump(2))
+    {
+        r += ch;
+        if (ch == '\n')
+            r += "  ";
+    }
+    return r;
+}
+
 void CompilationDatabaseGenerator::generate(const SwBuild &b)
 {
     checkForSingleSettingsInputs(b);
 
     const auto d = getRootDirectory(b);
+    const auto fragments_dir = d / "compdb.fragments";
 
     auto p = b.getExecutionPlan();
 
-    nlohmann::json j;
+    // one fragment per target
+    // fragments are formatted in parallel and cached by hash of their commands
+    struct Fragment
+    {
+        std::vector<std::shared_ptr<builder::Command>> commands;
+        path fn;
+        String text;
+    };
+    std::vector<Fragment> fragments;
     for (auto &[p, tgts] : b.getTargetsToBuild())
     {
         if (local_targets_only && p.getPath().isAbsolute())
             continue;
+        size_t i = 0;
         for (auto &tgt : tgts)
         {
+            auto &f = fragments.emplace_back();
             for (auto &c : tgt->getCommands())
             {
-                nlohmann::json j2;
                 if (!c->working_directory.empty()) {
-                    j2["directory"] = to_printable_string(normalize_path(c->working_directory));
                     // required by consumers (e.g. clion)
                     fs::create_directories(c->working_directory);
                 }
@@ -1313,40 +1371,79 @@ void CompilationDatabaseGenerator::generate(const SwBuild &b)
                 // we are fine to skip empty input commands (clion is not ok with them)
                 if (compdb_clion && c->inputs.size() == 1 && *c->inputs.begin() == c->arguments[0]->toString())
                     continue;
-                if (!c->inputs.empty())
+                f.commands.push_back(c);
+            }
+            f.fn = fragments_dir / (std::to_string(std::hash<String>()(p.toString() + "/" + std::to_string(i++))) + ".json");
+        }
+    }
+
+    std::unordered_set<path> used;
+    std::vector<Future<void>> fs;
+    for (auto &f : fragments)
+    {
+        used.insert(f.fn);
+        fs.push_back(getExecutor().push([this, &f]
+        {
+            // command hash does not cover inputs, so add them too
+            size_t h = 0;
+            hash_combine(h, compdb_clion);
+            hash_combine(h, allow_empty_file_directive);
+            for (auto &c : f.commands)
+            {
+                hash_combine(h, c->getHash());
+                for (auto &i : c->inputs)
+                    hash_combine(h, std::hash<path>()(i));
+            }
+            auto key = std::to_string(h) + "\n";
+
+            if (fs::exists(f.fn))
+            {
+                auto t = read_file(f.fn);
+                if (t.starts_with(key))
                 {
-                    bool cppset = false;
-                    for (auto &input : c->inputs)
-                    {
-                        auto i = exts.find(input.extension().string());
-                        if (i == exts.end())
-                            continue;
-                        j2["file"] = to_printable_string(normalize_path(input));
-                        cppset = true;
-                        break;
-                    }
-                    if (!cppset)
-                    {
-                        for (auto &input : c->inputs)
-                        {
-                            if (normalize_path(input) != normalize_path(c->getProgram()))
-                            {
-                                j2["file"] = to_printable_string(normalize_path(input));
-                                break;
-                            }
-                        }
-                    }
+                    f.text = t.substr(key.size());
+                    return;
                 }
-                if (allow_empty_file_directive && !j2.contains("file"))
-                    j2["file"] = "";
-                for (auto &a : c->arguments)
-                    j2["arguments"].push_back(a->toString());
-                j.push_back(j2);
             }
+
+            for (auto &c : f.commands)
+            {
+                if (!f.text.empty())
+                    f.text += ",\n";
+                f.text += compdb_record(*c, compdb_clion, allow_empty_file_directive);
+            }
+            write_file(f.fn, key + f.text);
+        }));
+    }
+    waitAndGet(fs);
+
+    // remove stale fragments
+    if (fs::exists(fragments_dir))
+    {
+        for (auto &e : fs::directory_iterator(fragments_dir))
+        {
+            if (!used.contains(e.path()))
+                fs::remove(e.path());
         }
     }
+
+    // stream the result
     const auto fn = "compile_commands.json";
-    write_file(d / fn, j.dump(2));
+    fs::create_directories(d);
+    std::ofstream o(d / fn, std::ios::binary);
+    if (!o)
+        throw SW_RUNTIME_ERROR("Cannot open file for writing: " + to_string(d / fn));
+    bool empty = true;
+    for (auto &f : fragments)
+    {
+        if (f.text.empty())
+            continue;
+        o << (empty ? "[\n" : ",\n") << f.text;
+        empty = false;
+    }
+    o << (empty ? "null" : "\n]");
+    o.close();
+
     if (compdb_symlink) {
         if (fs::exists(fn))
             fs::remove(fn);
@@ -6,6 +6,7 @@
 #include "commands.h"
 #include "self_upgrade.h"
 
+#include <sw/builder/execution_plan.h>
 #include <sw/builder/jumppad.h>
 #include <sw/driver/driver.h>
 #include <sw/manager/settings.h>
@@ -15,9 +16,72 @@
 #include <boost/dll.hpp>
 #include <boost/regex.hpp>
 
+#include <csignal>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "main");
 
+#ifdef _WIN32
+static std::atomic_bool interrupt_requested;
+#else
+static int interrupt_pipe[2] = { -1, -1 };
+#endif
+
+static void on_interrupt(int)
+{
+#ifdef _WIN32
+    // ctrl-c handler runs in its own thread on windows
+    interrupt_requested = true;
+    interrupt_requested.notify_one();
+#else
+    // self-pipe, write() is async-signal-safe
+    char c = 0;
+    [[maybe_unused]] auto r = write(interrupt_pipe[1], &c, 1);
+#endif
+}
+
+static void wait_for_interrupt()
+{
+#ifdef _WIN32
+    interrupt_requested.wait(false);
+#else
+    char c;
+    while (read(interrupt_pipe[0], &c, 1) == -1 && errno == EINTR)
+        ;
+#endif
+}
+
+// handler only wakes up a separate thread which stops commands
+static void setup_interrupt_handler()
+{
+#ifndef _WIN32
+    if (pipe(interrupt_pipe) == -1)
+    {
+        LOG_DEBUG(logger, "Cannot create interrupt pipe, ctrl-c terminates immediately");
+        return;
+    }
+    // must not leak into commands
+    for (auto fd : interrupt_pipe)
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    std::signal(SIGINT, on_interrupt);
+    std::thread([]
+    {
+        wait_for_interrupt();
+        // second ctrl-c terminates immediately
+        std::signal(SIGINT, SIG_DFL);
+        if (!sw::ExecutionPlan::interruptAll())
+            std::raise(SIGINT);
+        LOG_INFO(logger, "Interrupted, stopping running commands");
+    }).detach();
+}
+
 static void print_command_line(const Strings &args, const Strings &args_expanded)
 {
     String cmdline;
@@ -168,6 +232,8 @@ int StartupData::run()
             return *exit_code;
 
         sw_main();
+        // after all builds, so export errors fail the run
+        sw::driver::cpp::Driver::exportChecks();
         exit_code = 0;
     }
     catch (const std::exception &e)
@@ -325,17 +391,6 @@ void StartupData::setup()
         return;
     }
 
-    // before storages
-    // Create QSBR context for the main thread.
-    //auto context = createConcurrentContext();
-    //getConcurrentContext(&context);
-
-    SCOPE_EXIT
-    {
-        // Destroy the QSBR context for the main thread.
-        //destroyConcurrentContext(context);
-    };
-
     if (!getOptions().options_build.ide_fast_path.empty() && fs::exists(getOptions().options_build.ide_fast_path))
     {
         auto files = read_lines(getOptions().options_build.ide_fast_path);
@@ -367,6 +422,8 @@ void StartupData::setup()
 
 void StartupData::sw_main()
 {
+    setup_interrupt_handler();
+
     SwClientContext swctx(getOptions());
 
     // for cli we set default input to '.' dir
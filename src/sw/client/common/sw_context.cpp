@@ -419,6 +419,7 @@ std::unique_ptr<sw::SwBuild> SwClientContext::createBuildInternal()
         bs["skip_errors"] = std::to_string(options.skip_errors);
 
     SET_BOOL_OPTION(time_trace);
+    SET_BOOL_OPTION(reduce_graph);
     SET_BOOL_OPTION(show_output);
     SET_BOOL_OPTION(write_output_to_file);
 
@@ -438,6 +439,11 @@ std::unique_ptr<sw::SwBuild> SwClientContext::createBuildInternal()
     SET_BOOL_OPTION(wait_for_cc_checks);
     SET_BOOL_OPTION(cc_checks_sh_shell);
     bs["cc_checks_command"] = options.cc_checks_command;
+    bs["checks_cache_dir"] = options.checks_cache_dir;
+    bs["checks_import"] = options.checks_import;
+    bs["checks_export"] = options.checks_export;
+    if (!options.binary_cache_dir.empty())
+        bs["binary_cache_dir"] = to_string(normalize_path(fs::absolute(options.binary_cache_dir)));
 
 #undef SET_BOOL_OPTION
 
@@ -824,6 +830,7 @@ sw::SwContext &SwClientContext::getContext(bool in_allow_network)
         u.gExplainOutdatedToTrace = getOptions().explain_outdated_to_trace;
 
         u.save_command_format = getOptions().save_command_format;
+        u.status_line = !getOptions().no_status_line && !getOptions().verbose && !getOptions().trace;
 
         //
         sw::TargetSettings cs;
@@ -831,6 +838,7 @@ sw::SwContext &SwClientContext::getContext(bool in_allow_network)
         SET_BOOL_OPTION(debug_configs);
         SET_BOOL_OPTION(ignore_outdated_configs);
         SET_BOOL_OPTION(do_not_remove_bad_module);
+        SET_BOOL_OPTION(configs_many2one);
 #undef SET_BOOL_OPTION
 
         // create ctx
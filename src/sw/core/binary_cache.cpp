@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#include "binary_cache.h"
+
+#include <nlohmann/json.hpp>
+#include <primitives/hash.h>
+#include <primitives/lock.h>
+#include <primitives/pack.h>
+#include <primitives/templates.h>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "binary_cache");
+
+#define ARTIFACT_ID_FILENAME "artifact.id"
+#define LOCAL_ARTIFACT_ID_FILENAME "artifact.local.id"
+
+namespace sw
+{
+
+namespace
+{
+
+struct Manifest
+{
+    String id;
+    String hash; // archive hash
+    BinaryCache::Dependencies deps;
+};
+
+}
+
+static std::optional<Manifest> read_manifest(const path &fn)
+{
+    try
+    {
+        auto j = nlohmann::json::parse(read_file(fn));
+        Manifest m;
+        m.id = j["id"].get<String>();
+        m.hash = j["hash"].get<String>();
+        for (auto &d : j["dependencies"])
+            m.deps.push_back({ d["key"].get<String>(), d["id"].get<String>() });
+        return m;
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Bad artifact manifest " << normalize_path(fn) << ": " << e.what());
+    }
+    return {};
+}
+
+// we do not need them to use the package
+static bool is_intermediate_file(const path &p)
+{
+    static const std::set<String> exts{ ".o", ".obj", ".d", ".ilk", ".iobj", ".ipdb", ".pch", ".gch", ".rsp", ".tmp" };
+    return exts.contains(to_string(p.extension().u8string())) || p.filename() == ARTIFACT_ID_FILENAME || p.filename() == LOCAL_ARTIFACT_ID_FILENAME;
+}
+
+BinaryCache::BinaryCache(const path &dir, const path &storage_dir)
+    : dir(dir), storage_dir(normalize_path(storage_dir))
+{
+}
+
+String BinaryCache::getKey(const PackageId &p, const String &cfg)
+{
+    return p.toString() + ":" + cfg;
+}
+
+String BinaryCache::getArtifactId(const PackageId &p, const String &cfg, const Dependencies &deps)
+{
+    auto sorted = deps;
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+    String s = getKey(p, cfg) + "\n";
+    for (auto &d : sorted)
+        s += d.key + "=" + d.id + "\n";
+    return shorten_hash(blake2b_512(s), 32);
+}
+
+path BinaryCache::getArtifactsDir(const PackageId &p, const String &cfg) const
+{
+    return dir / p.toString() / cfg;
+}
+
+String BinaryCache::getRestoredId(const LocalPackage &p, const String &cfg)
+{
+    auto fn = p.getDirObj(cfg) / ARTIFACT_ID_FILENAME;
+    if (!fs::exists(fn))
+        return {};
+    return read_file(fn);
+}
+
+String BinaryCache::getLocalId(const LocalPackage &p, const String &cfg)
+{
+    auto fn = p.getDirObj(cfg) / LOCAL_ARTIFACT_ID_FILENAME;
+    if (!fs::exists(fn))
+        return {};
+    return read_file(fn);
+}
+
+void BinaryCache::setLocalId(const LocalPackage &p, const String &cfg, const String &id)
+{
+    write_file_if_different(p.getDirObj(cfg) / LOCAL_ARTIFACT_ID_FILENAME, id);
+}
+
+// id of dependency as it is present here, restores it if needed
+std::optional<String> BinaryCache::getDependencyId(const LocalPackage &p, const Dependency &d)
+{
+    // predefined (programs etc.), settings describe them
+    if (d.id == d.key)
+        return d.id;
+    if (auto i = selected.find(d.key); i != selected.end())
+        return i->second;
+
+    auto pos = d.key.rfind(':');
+    if (pos == d.key.npos)
+        return {};
+    LocalPackage dp(p.getStorage(), PackageId(d.key.substr(0, pos)));
+    auto cfg = d.key.substr(pos + 1);
+    if (auto id = getLocalId(dp, cfg); !id.empty())
+        return id;
+    // built here earlier, but its id is unknown
+    if (fs::exists(dp.getDirObj(cfg)) && getRestoredId(dp, cfg).empty())
+        return {};
+    auto id = restore1(dp, cfg);
+    if (id.empty())
+        return {};
+    return id;
+}
+
+String BinaryCache::restore(const LocalPackage &p, const String &cfg)
+{
+    std::unique_lock lk(m);
+    return restore1(p, cfg);
+}
+
+String BinaryCache::restore1(const LocalPackage &p, const String &cfg)
+{
+    auto key = getKey(p, cfg);
+    if (auto i = selected.find(key); i != selected.end())
+        return i->second;
+    if (!restoring.insert(key).second)
+        return {};
+    SCOPE_EXIT
+    {
+        restoring.erase(key);
+    };
+
+    auto adir = getArtifactsDir(p, cfg);
+
+    // expected id is computed from ids of dependencies present here
+    auto is_valid = [this, &p, &cfg](const Manifest &m)
+    {
+        Dependencies deps;
+        for (auto &d : m.deps)
+        {
+            auto id = getDependencyId(p, d);
+            if (!id)
+                return false;
+            deps.push_back({ d.key, *id });
+        }
+        return getArtifactId(p, cfg, deps) == m.id;
+    };
+
+    // already restored
+    if (auto id = getRestoredId(p, cfg); !id.empty())
+    {
+        if (auto m = read_manifest(adir / (id + ".json")); m && m->id == id && is_valid(*m))
+        {
+            selected[key] = id;
+            return id;
+        }
+        LOG_DEBUG(logger, "Restored artifact does not match dependencies: [" + p.toString() + "]/[" + cfg + "]");
+    }
+
+    if (!fs::exists(adir))
+        return {};
+
+    std::vector<std::pair<fs::file_time_type, path>> manifests;
+    for (auto &f : fs::directory_iterator(adir))
+    {
+        if (f.path().extension() == ".json")
+            manifests.emplace_back(f.last_write_time(), f.path());
+    }
+    // newest first
+    std::sort(manifests.begin(), manifests.end(), std::greater<>{});
+
+    for (auto &[_, fn] : manifests)
+    {
+        auto m = read_manifest(fn);
+        if (!m || !is_valid(*m))
+            continue;
+
+        auto archive = adir / support::make_archive_name(m->id);
+        if (!fs::exists(archive))
+            continue;
+        if (strong_file_hash_file(archive) != m->hash)
+        {
+            LOG_WARN(logger, "Corrupted artifact: " << normalize_path(archive));
+            continue;
+        }
+
+        auto obj = p.getDirObj(cfg);
+        {
+            // other processes may restore or build the same package
+            ScopedFileLock flk(obj);
+            if (getRestoredId(p, cfg) != m->id)
+            {
+                LOG_INFO(logger, "Using prebuilt: [" + p.toString() + "]/[" + cfg + "]");
+                error_code ec;
+                fs::remove_all(obj, ec);
+                unpack_file(archive, storage_dir);
+                write_file(obj / ARTIFACT_ID_FILENAME, m->id);
+            }
+        }
+        selected[key] = m->id;
+        return m->id;
+    }
+    return {};
+}
+
+bool BinaryCache::publish(const LocalPackage &p, const String &cfg, const Dependencies &deps, const Files &outputs)
+{
+    auto id = getArtifactId(p, cfg, deps);
+    auto adir = getArtifactsDir(p, cfg);
+    auto manifest_fn = adir / (id + ".json");
+    if (fs::exists(manifest_fn))
+        return true;
+
+    // everything must be relocatable
+    std::map<path, path> files;
+    auto add = [this, &files](const path &f)
+    {
+        auto rel = normalize_path(f).lexically_relative(storage_dir);
+        if (rel.empty() || *rel.begin() == "..")
+            return false;
+        files[f] = rel;
+        return true;
+    };
+    auto obj = p.getDirObj(cfg);
+    for (auto &f : fs::recursive_directory_iterator(obj))
+    {
+        if (f.is_regular_file() && !is_intermediate_file(f.path()))
+            add(f.path());
+    }
+    for (auto &f : outputs)
+    {
+        if (!fs::exists(f) || !add(f))
+        {
+            LOG_DEBUG(logger, "Cannot store artifact for " << p.toString() << ": bad output " << normalize_path(f));
+            return false;
+        }
+    }
+
+    // store may be shared, so readers must not see partial artifacts
+    // manifest goes last
+    try
+    {
+        fs::create_directories(adir);
+        auto archive = adir / support::make_archive_name(id);
+        // keep archive extension for packer
+        auto tmp = adir / (to_string(unique_path().u8string()) + "." + support::make_archive_name(id));
+        SCOPE_EXIT
+        {
+            error_code ec;
+            fs::remove(tmp, ec);
+        };
+        if (!pack_files(tmp, files))
+            throw SW_RUNTIME_ERROR("cannot pack files");
+
+        nlohmann::json j;
+        j["id"] = id;
+        j["package"] = p.toString();
+        j["config"] = cfg;
+        j["hash"] = strong_file_hash_file(tmp);
+        for (auto &d : deps)
+        {
+            nlohmann::json jd;
+            jd["key"] = d.key;
+            jd["id"] = d.id;
+            j["dependencies"].push_back(jd);
+        }
+        fs::rename(tmp, archive);
+
+        auto mtmp = path(manifest_fn) += "." + to_string(unique_path().u8string()) + ".tmp";
+        write_file(mtmp, j.dump(2));
+        fs::rename(mtmp, manifest_fn);
+    }
+    catch (std::exception &e)
+    {
+        LOG_WARN(logger, "Cannot store artifact for " << p.toString() << ": " << e.what());
+        return false;
+    }
+
+    LOG_DEBUG(logger, "Stored artifact for " << p.toString() << ": " << id);
+    return true;
+}
+
+} // namespace sw
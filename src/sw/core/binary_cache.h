@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#pragma once
+
+#include <sw/manager/package.h>
+
+#include <mutex>
+#include <unordered_set>
+
+namespace sw
+{
+
+/// Store of prebuilt package binaries in a local (or mounted) directory.
+///
+/// Artifact id is a hash of package id, its settings hash and ids of its dependencies,
+/// so package is never restored against differently built dependencies.
+/// Artifact is accepted only when ids of dependencies present here
+/// (restored or built locally) give the same id.
+///
+/// Layout:
+///  <dir>/<package>/<cfg>/<id>.json - manifest
+///  <dir>/<package>/<cfg>/<id>.tar.gz - files, paths are relative to storage dir
+struct SW_CORE_API BinaryCache
+{
+    struct Dependency
+    {
+        String key; // package + cfg
+        String id;
+    };
+    using Dependencies = std::vector<Dependency>;
+
+    BinaryCache(const path &dir, const path &storage_dir);
+
+    static String getKey(const PackageId &, const String &cfg);
+    static String getArtifactId(const PackageId &, const String &cfg, const Dependencies &);
+
+    /// unpacks suitable artifact into local storage
+    /// returns artifact id or empty string
+    String restore(const LocalPackage &, const String &cfg);
+
+    /// stores object dir of the package (without intermediate files) and outputs
+    /// returns false if artifact was not stored
+    bool publish(const LocalPackage &, const String &cfg, const Dependencies &, const Files &outputs);
+
+    /// artifact id of restored package, empty if package was built here
+    static String getRestoredId(const LocalPackage &, const String &cfg);
+
+    /// artifact id of package built here, empty if it is not known
+    static String getLocalId(const LocalPackage &, const String &cfg);
+    static void setLocalId(const LocalPackage &, const String &cfg, const String &id);
+
+private:
+    path dir;
+    path storage_dir;
+    std::mutex m;
+    // key -> id
+    std::unordered_map<String, String> selected;
+    // cycle guard
+    std::unordered_set<String> restoring;
+
+    path getArtifactsDir(const PackageId &, const String &cfg) const;
+    String restore1(const LocalPackage &, const String &cfg);
+    std::optional<String> getDependencyId(const LocalPackage &, const Dependency &);
+};
+
+} // namespace sw
@@ -3,15 +3,19 @@
 
 #include "build.h"
 
+#include "binary_cache.h"
 #include "driver.h"
 #include "input.h"
+#include "specification.h"
 #include "sw_context.h"
 
 #include <sw/builder/execution_plan.h>
 #include <sw/builder/jumppad.h>
+#include <sw/manager/package_database.h>
 #include <sw/manager/storage.h>
 
 #include <boost/current_function.hpp>
+#include <boost/dll.hpp>
 #include <magic_enum/magic_enum.hpp>
 #include <nlohmann/json.hpp>
 #include <primitives/date_time.h>
@@ -97,6 +101,19 @@ static std::shared_ptr<PredefinedTarget> create_target(const LocalPackage &p, co
     return {};
 }
 
+// saved config or prebuilt artifact
+static std::shared_ptr<PredefinedTarget> create_target(const LocalPackage &p, const TargetSettings &s, bool usc, BinaryCache *bc)
+{
+    if (usc)
+    {
+        if (auto tgt = create_target(p, s))
+            return tgt;
+    }
+    if (bc && p.getPath().isAbsolute() && !p.isOverridden() && !bc->restore(p, s.getHash()).empty())
+        return create_target(p, s);
+    return {};
+}
+
 static auto can_use_saved_configs(const SwBuild &b)
 {
     auto &s = b.getSettings();
@@ -107,7 +124,19 @@ static auto can_use_saved_configs(const SwBuild &b)
         ;
 }
 
-static std::unordered_map<UnresolvedPackage, PackageId> loadLockFile(const path &fn/*, SwContext &swctx*/)
+namespace
+{
+
+struct LockFile
+{
+    std::unordered_map<UnresolvedPackage, PackageId> packages;
+    // source archive hashes, older lock files do not have them
+    std::unordered_map<PackageId, String> hashes;
+};
+
+}
+
+static LockFile loadLockFile(const path &fn/*, SwContext &swctx*/)
 {
     auto j = nlohmann::json::parse(read_file(fn));
     if (j["schema"]["version"].is_null())
@@ -120,7 +149,7 @@ static std::unordered_map<UnresolvedPackage, PackageId> loadLockFile(const path
             ", expected " + std::to_string(SW_CURRENT_LOCK_FILE_VERSION));
     }
 
-    std::unordered_map<UnresolvedPackage, PackageId> m;
+    LockFile lf;
 
     /*for (auto &v : j["packages"])
     {
@@ -155,9 +184,11 @@ static std::unordered_map<UnresolvedPackage, PackageId> loadLockFile(const path
         d = *i;
         if (v.value().find("installed") != v.value().end())
             d.installed = v.value()["installed"];*/
-        m.emplace(u, id);
+        if (v.value().find("hash") != v.value().end())
+            lf.hashes[id] = v.value()["hash"].get<std::string>();
+        lf.packages.emplace(u, id);
     }
-    return m;
+    return lf;
 }
 
 static void saveLockFile(const path &fn, const std::unordered_map<UnresolvedPackage, LocalPackage> &pkgs)
@@ -186,6 +217,8 @@ static void saveLockFile(const path &fn, const std::unordered_map<UnresolvedPack
     for (auto &[u, r] : std::map<UnresolvedPackage, LocalPackage>(pkgs.begin(), pkgs.end()))
     {
         jp[u.toString()]["package"] = r.toString();
+        if (!r.isOverridden())
+            jp[u.toString()]["hash"] = r.getData().getHash(StorageFileType::SourceArchive);
         //if (r.installed)
             //jp[u.toString()]["installed"] = true;
     }
@@ -193,6 +226,38 @@ static void saveLockFile(const path &fn, const std::unordered_map<UnresolvedPack
     write_file_if_different(fn, j.dump(2));
 }
 
+// lock file pins exact packages, so there is nothing to resolve
+// unpacked package is checked by its stamp, only missing packages go to remotes
+// package data is still read from the local packages db later,
+// so its row must be present too
+static void install_locked_packages(const SwContext &swctx, const LockFile &lf)
+{
+    std::unordered_set<PackageId> ids;
+    for (auto &[u, p] : lf.packages)
+        ids.insert(p);
+
+    auto &ls = swctx.getLocalStorage();
+    UnresolvedPackages missing;
+    for (auto &id : ids)
+    {
+        if (ls.isPackageOverridden(id))
+            continue;
+        LocalPackage p(ls, id);
+        auto stamp = p.getStampHash();
+        auto i = lf.hashes.find(id);
+        bool installed = i == lf.hashes.end() ? !stamp.empty() : stamp == i->second;
+        // stamp may survive db removal
+        if (installed && ls.isPackageInstalled(p))
+            continue;
+        missing.insert(id);
+    }
+    if (missing.empty())
+        return;
+    LOG_DEBUG(logger, "Installing " << missing.size() << " locked packages");
+    // downloads in parallel
+    swctx.install(missing, false);
+}
+
 static ExecutionPlan::Clock::duration parseTimeLimit(String tl)
 {
     enum duration_type
@@ -260,11 +325,41 @@ path SwBuild::getBuildDirectory() const
     return build_dir;
 }
 
+void SwBuild::registerSharedPrecompiledHeader(const String &key, const String &target) const
+{
+    // does not depend on registration order
+    std::unique_lock lk(shared_pchs_mutex);
+    auto [i, inserted] = shared_pchs.emplace(key, target);
+    if (!inserted && target < i->second)
+        i->second = target;
+}
+
+String SwBuild::getSharedPrecompiledHeaderOwner(const String &key) const
+{
+    std::unique_lock lk(shared_pchs_mutex);
+    auto i = shared_pchs.find(key);
+    if (i == shared_pchs.end())
+        throw SW_RUNTIME_ERROR("Unknown shared pch: " + key);
+    return i->second;
+}
+
+void SwBuild::addGlobbedDirectory(const path &dir, bool recursive) const
+{
+    std::unique_lock lk(globbed_dirs_mutex);
+    globbed_dirs[dir] |= recursive;
+}
+
+void SwBuild::addFastPathDependency(const path &f) const
+{
+    std::unique_lock lk(fast_path_deps_mutex);
+    fast_path_deps.insert(f);
+}
+
 void SwBuild::stop()
 {
     stopped = true;
     if (current_explan)
-        current_explan->stop();
+        current_explan->stop(true);
 }
 
 void SwBuild::build()
@@ -287,8 +382,24 @@ void SwBuild::build()
     ScopedTime t;
 
     // this is all in one call
-    while (step())
-        ;
+    if (build_settings["fast_path"] != "true")
+    {
+        while (step())
+            ;
+    }
+    else if (!runFastPath())
+    {
+        while (state != BuildState::Prepared && step())
+            ;
+        if (state == BuildState::Prepared && !stopped)
+        {
+            auto p = getExecutionPlan();
+            saveFastPath(*p);
+            execute(*p);
+        }
+        while (step())
+            ;
+    }
 
     if (build_settings["measure"] == "true")
         LOG_DEBUG(logger, BOOST_CURRENT_FUNCTION << " time: " << t.getTimeFloat() << " s.");
@@ -466,20 +577,17 @@ void SwBuild::resolvePackages(const std::vector<IDependency*> &udeps)
     {
         must_update_lock_file = false; // no need to update, we are loading
 
-        auto m = loadLockFile(build_settings["lock_file"].getValue());
+        auto lf = loadLockFile(build_settings["lock_file"].getValue());
         if (build_settings["update_lock_file_packages"])
         {
             for (auto &[u, p] : build_settings["update_lock_file_packages"].getMap())
             {
-                m.erase(u);
+                lf.packages.erase(u);
                 must_update_lock_file = true; // must update lock file here
             }
         }
-        getContext().setCachedPackages(m);
-        UnresolvedPackages upkgs;
-        for (auto &[u, p] : m)
-            upkgs.insert(p); // add exactly p, not u!
-        swctx.install(upkgs, false);
+        getContext().setCachedPackages(lf.packages);
+        install_locked_packages(swctx, lf);
     }
 
     UnresolvedPackages upkgs;
@@ -493,10 +601,11 @@ void SwBuild::resolvePackages(const std::vector<IDependency*> &udeps)
     for (auto &[u, p] : m)
         targets[p];
 
-    if (can_use_saved_configs(*this))
+    auto usc = can_use_saved_configs(*this);
+    if (usc || binary_cache)
     {
         std::function<bool(const std::vector<IDependency*> &)> load_targets;
-        load_targets = [this, &load_targets](const std::vector<IDependency*> &udeps)
+        load_targets = [this, usc, &load_targets](const std::vector<IDependency*> &udeps)
         {
             bool everything_resolved = true;
             for (auto d : udeps)
@@ -513,7 +622,7 @@ void SwBuild::resolvePackages(const std::vector<IDependency*> &udeps)
                 auto p = LocalPackage(getContext().getLocalStorage(), pi->first);
                 if (getTargets().find(p, d->getSettings()))
                     continue;
-                auto tgt = create_target(p, d->getSettings());
+                auto tgt = create_target(p, d->getSettings(), usc, binary_cache.get());
                 if (tgt)
                 {
                     getTargets()[tgt->getPackage()].push_back(tgt);
@@ -539,7 +648,7 @@ void SwBuild::resolvePackages(const std::vector<IDependency*> &udeps)
         try
         {
             // may throw
-            auto mold = loadLockFile(build_settings["lock_file"].getValue());
+            auto mold = loadLockFile(build_settings["lock_file"].getValue()).packages;
             for (auto &[u, p] : mold)
             {
                 auto i = m.find(u);
@@ -658,10 +767,10 @@ void SwBuild::loadPackages(const TargetMap &predefined)
             if (s.empty())
                 continue;
 
-            if (usc)
+            if (usc || binary_cache)
             {
                 LocalPackage p(getContext().getLocalStorage(), d.first);
-                auto tgt = create_target(p, s);
+                auto tgt = create_target(p, s, usc, binary_cache.get());
                 if (tgt)
                 {
                     getTargets()[tgt->getPackage()].push_back(tgt);
@@ -795,6 +904,93 @@ void SwBuild::execute() const
     execute(*p);
 }
 
+// stores packages built from source, so other machines can skip them
+static void publish_artifacts(const SwBuild &b, BinaryCache &bc, Executor &e)
+{
+    auto is_storage_target = [&b](const ITarget &t)
+    {
+        auto &p = t.getPackage();
+        return p.getPath().isAbsolute() && !p.isOverridden()
+            && b.getContext().getPredefinedTargets().find(PackageId(p)) == b.getContext().getPredefinedTargets().end();
+    };
+
+    // id depends on ids of deps
+    // nullopt means target cannot be stored
+    std::unordered_map<const ITarget *, std::optional<String>> ids;
+    std::unordered_map<const ITarget *, BinaryCache::Dependencies> target_deps;
+    std::function<std::optional<String>(const ITarget &)> get_id;
+    get_id = [&](const ITarget &t) -> std::optional<String>
+    {
+        if (auto i = ids.find(&t); i != ids.end())
+            return i->second;
+        ids[&t]; // break cycles
+        BinaryCache::Dependencies deps;
+        for (auto d : t.getDependencies())
+        {
+            if (!d->isResolved())
+                return {};
+            auto &dt = d->getTarget();
+            BinaryCache::Dependency bd;
+            bd.key = BinaryCache::getKey(dt.getPackage(), dt.getSettings().getHash());
+            if (is_storage_target(dt))
+            {
+                auto id = get_id(dt);
+                if (!id)
+                    return {};
+                bd.id = *id;
+            }
+            else if (dt.getPackage().getPath().isAbsolute() && !dt.getPackage().isOverridden())
+                bd.id = bd.key; // predefined (programs etc.), settings describe them
+            else
+                return {}; // local or overridden, not reproducible
+            deps.push_back(bd);
+        }
+        ids[&t] = BinaryCache::getArtifactId(t.getPackage(), t.getSettings().getHash(), deps);
+        target_deps[&t] = std::move(deps);
+        return ids[&t];
+    };
+
+    Futures<void> jobs;
+    for (const auto &[pkg, tgts] : b.getTargets())
+    {
+        for (auto &tgt : tgts)
+        {
+            // publish only what was built here
+            if (tgt->as<const PredefinedTarget *>() || !is_storage_target(*tgt))
+                continue;
+            auto cfg = tgt->getSettings().getHash();
+            LocalPackage p(b.getContext().getLocalStorage(), tgt->getPackage());
+            if (!fs::exists(p.getDirObj(cfg) / get_settings_fn()) || !BinaryCache::getRestoredId(p, cfg).empty())
+                continue;
+            auto id = get_id(*tgt);
+            if (!id)
+                continue;
+            // dependents restored later are checked against it
+            BinaryCache::setLocalId(p, cfg, *id);
+
+            Files outputs;
+            try
+            {
+                for (auto &[_, f] : tgt->getFiles(StorageFileType::BinaryArchive))
+                {
+                    if (!f.getPath().empty())
+                        outputs.insert(f.getPath());
+                }
+            }
+            catch (std::exception &)
+            {
+                // not a binary target
+                continue;
+            }
+            jobs.push_back(e.push([&bc, p, cfg, deps = target_deps[tgt.get()], outputs]
+            {
+                bc.publish(p, cfg, deps, outputs);
+            }));
+        }
+    }
+    waitAndGet(jobs);
+}
+
 void SwBuild::execute(ExecutionPlan &p) const
 {
     CHECK_STATE_AND_CHANGE(BuildState::Prepared, BuildState::Executed);
@@ -811,21 +1007,99 @@ void SwBuild::execute(ExecutionPlan &p) const
     ScopedTime t;
     p.execute(getBuildExecutor());
     if (build_settings["measure"] == "true")
-        LOG_DEBUG(logger, BOOST_CURRENT_FUNCTION << " time: " << t.getTimeFloat() << " s.");
+    {
+        auto &s = p.getStats();
+        LOG_DEBUG(logger, BOOST_CURRENT_FUNCTION << " time: " << t.getTimeFloat() << " s., "
+            << p.getCommands().size() << " commands, " << s.edges << " edges");
+        if (build_settings["reduce_graph"] == "true")
+        {
+            LOG_DEBUG(logger, "transitive reduction: removed " << s.removed_edges << " edges in "
+                << std::chrono::duration_cast<std::chrono::duration<float>>(s.transitive_reduction_time).count() << " s.");
+        }
+    }
+
+    if (binary_cache)
+        publish_artifacts(*this, *binary_cache, getBuildExecutor());
 
     if (build_settings["time_trace"] == "true")
         p.saveChromeTrace(getBuildDirectory() / "misc" / "time_trace.json");
 }
 
-Commands SwBuild::getCommands() const
+// targets read commands of their (transitive) dependencies,
+// so we run them in waves, each target after all of its deps
+// commands are cached by targets, so later calls are cheap
+// data shared between targets of one wave is locked:
+// file generators (File::setGenerator()) and generated commands of deps (native.cpp)
+static void prepare_target_commands(const TargetMap &targets, Executor &e)
 {
-    // calling this for all targets in any case to set proper command dependencies
-    for (const auto &[pkg, tgts] : getTargets())
+    std::unordered_map<const ITarget *, std::vector<const ITarget *>> dependents;
+    std::unordered_map<const ITarget *, size_t> left;
+    for (const auto &[pkg, tgts] : targets)
     {
         for (auto &tgt : tgts)
-            tgt->getCommands();
+            left[tgt.get()];
+    }
+    for (auto &[t, n] : left)
+    {
+        std::unordered_set<const ITarget *> deps;
+        for (auto d : t->getDependencies())
+        {
+            if (!d->isResolved())
+                continue;
+            auto dt = &d->getTarget();
+            if (dt == t || left.find(dt) == left.end() || !deps.insert(dt).second)
+                continue;
+            dependents[dt].push_back(t);
+            n++;
+        }
+    }
+
+    std::vector<const ITarget *> wave;
+    for (auto &[t, n] : left)
+    {
+        if (n == 0)
+            wave.push_back(t);
+    }
+    size_t done = 0;
+    while (!wave.empty())
+    {
+        Futures<void> jobs;
+        for (auto t : wave)
+            jobs.push_back(e.push([t] { t->getCommands(); }));
+        waitAndGet(jobs);
+        done += wave.size();
+
+        std::vector<const ITarget *> next;
+        for (auto t : wave)
+        {
+            for (auto d : dependents[t])
+            {
+                if (--left[d] == 0)
+                    next.push_back(d);
+            }
+        }
+        wave = std::move(next);
     }
 
+    // circular deps, keep old serial behavior for them
+    if (done != left.size())
+    {
+        for (const auto &[pkg, tgts] : targets)
+        {
+            for (auto &tgt : tgts)
+            {
+                if (left[tgt.get()])
+                    tgt->getCommands();
+            }
+        }
+    }
+}
+
+Commands SwBuild::getCommands() const
+{
+    // calling this for all targets in any case to set proper command dependencies
+    prepare_target_commands(getTargets(), getPrepareExecutor());
+
     if (targets_to_build.empty())
         throw SW_RUNTIME_ERROR("no targets were selected for building");
 
@@ -944,12 +1218,28 @@ Commands SwBuild::getCommands() const
     auto cl_write_output_to_file = build_settings["write_output_to_file"] == "true";
 
     // gather commands
+    // they are cached by targets already, so just merge them
     Commands cmds;
-    for (auto &[p, tgts] : ttb)
     {
-        for (auto &tgt : tgts)
+        std::vector<const ITarget *> tgts_v;
+        for (auto &[p, tgts] : ttb)
+        {
+            for (auto &tgt : tgts)
+                tgts_v.push_back(tgt.get());
+        }
+        std::vector<Commands> tcmds(tgts_v.size());
+        auto &e = getPrepareExecutor();
+        Futures<void> fs;
+        for (size_t i = 0; i < tgts_v.size(); i++)
+            fs.push_back(e.push([&tcmds, &tgts_v, i] { tcmds[i] = tgts_v[i]->getCommands(); }));
+        waitAndGet(fs);
+
+        size_t n = 0;
+        for (auto &c : tcmds)
+            n += c.size();
+        cmds.reserve(n);
+        for (auto &c : tcmds)
         {
-            auto c = tgt->getCommands();
             for (auto &c2 : c)
             {
                 c2->show_output = cl_show_output || cl_write_output_to_file; // only for selected targets
@@ -962,6 +1252,9 @@ Commands SwBuild::getCommands() const
     path copy_dir = build_settings["build_ide_copy_to_dir"].isValue() ? build_settings["build_ide_copy_to_dir"].getValue() : "";
     {
         std::unordered_map<path, path> copy_files;
+        // staged files of every target go to their own command,
+        // so targets are staged in parallel and only changed ones rerun
+        std::map<const ITarget *, std::map<path, path>> target_copy_files;
         for (auto &[p, tgts] : ttb)
         {
             for (auto &tgt : tgts)
@@ -997,7 +1290,8 @@ Commands SwBuild::getCommands() const
 
                 PackageIdSet visited_pkgs;
                 std::function<void(const TargetSettings &)> copy_file;
-                copy_file = [this, &copy_dir_current, &copy_files, &copy_file, &visited_pkgs](const TargetSettings &s)
+                auto &tgt_copy_files = target_copy_files[tgt.get()];
+                copy_file = [this, &copy_dir_current, &copy_files, &tgt_copy_files, &copy_file, &visited_pkgs](const TargetSettings &s)
                 {
                     if (s["header_only"] == "true")
                         return;
@@ -1028,6 +1322,7 @@ Commands SwBuild::getCommands() const
                         if (copy_files.find(in) != copy_files.end())
                             return;
                         copy_files[in] = o;
+                        tgt_copy_files[in] = o;
                         fast_path_files.insert(o);
                     }
 
@@ -1063,15 +1358,23 @@ Commands SwBuild::getCommands() const
             }
         }
 
-        for (auto &[f, t] : copy_files)
+        // one in-process command per target
+        // files are reflinked, hardlinked or copied, up to date files are skipped
+        for (auto &[tgt, tgt_copy_files] : target_copy_files)
         {
-            auto copy_cmd = std::make_shared<::sw::builder::BuiltinCommand>(*this, SW_VISIBLE_BUILTIN_FUNCTION(copy_file));
-            copy_cmd->arguments.push_back(f);
-            copy_cmd->arguments.push_back(t);
-            copy_cmd->addInput(f);
-            copy_cmd->addOutput(t);
-            //copy_cmd->dependencies.insert(nt->getCommand());
-            copy_cmd->name = "copy: " + to_string(normalize_path(t));
+            if (tgt_copy_files.empty())
+                continue;
+            auto copy_cmd = std::make_shared<::sw::builder::BuiltinCommand>(*this, SW_VISIBLE_BUILTIN_FUNCTION(stage_files));
+            Strings files;
+            for (auto &[f, t] : tgt_copy_files)
+            {
+                files.push_back(to_string(f));
+                files.push_back(to_string(t));
+                copy_cmd->addInput(f);
+                copy_cmd->addOutput(t);
+            }
+            copy_cmd->push_back(files);
+            copy_cmd->name = "stage: [" + tgt->getPackage().toString() + "]: " + std::to_string(tgt_copy_files.size()) + " files";
             copy_cmd->command_storage = &getCommandStorage(getBuildDirectory() / "cs");
             cmds.insert(copy_cmd);
             commands_storage.insert(copy_cmd); // prevents early destruction
@@ -1088,7 +1391,7 @@ std::unique_ptr<ExecutionPlan> SwBuild::getExecutionPlan() const
 
 std::unique_ptr<ExecutionPlan> SwBuild::getExecutionPlan(const Commands &cmds) const
 {
-    auto ep = ExecutionPlan::create(cmds);
+    auto ep = ExecutionPlan::create(cmds, build_settings["reduce_graph"] == "true");
     if (ep->isValid())
         return std::move(ep);
 
@@ -1263,6 +1566,209 @@ void SwBuild::runSavedExecutionPlan(const path &in) const
     execute(*p);
 }
 
+// mtime and size are enough here, sources are checked by commands
+static String get_file_stamp(const path &p)
+{
+    error_code ec;
+    auto t = fs::last_write_time(p, ec);
+    if (ec)
+        return "-";
+    auto sz = fs::file_size(p, ec);
+    return std::to_string(t.time_since_epoch().count()) + ":" + std::to_string(ec ? 0 : sz);
+}
+
+// same rules as globbing: hidden entries are skipped
+static void list_directory(const path &dir, bool recursive, Strings &files)
+{
+    error_code ec;
+    for (auto &f : fs::directory_iterator(dir, ec))
+    {
+        auto fn = to_string(f.path().filename().u8string());
+        if (fn.empty() || fn[0] == '.')
+            continue;
+        if (f.is_directory(ec))
+        {
+            if (recursive)
+                list_directory(f.path(), recursive, files);
+            continue;
+        }
+        files.push_back(to_string(normalize_path(f.path())));
+    }
+}
+
+static String get_directory_listing_hash(const path &dir, bool recursive)
+{
+    Strings files;
+    list_directory(dir, recursive, files);
+    std::sort(files.begin(), files.end());
+    String s;
+    for (auto &f : files)
+        s += f + "\n";
+    return shorten_hash(blake2b_512(s), 16);
+}
+
+static String get_environment_hash()
+{
+    // read by toolchain detection and compilers
+    static const Strings vars
+    {
+        "PATH", "INCLUDE", "LIB", "LIBPATH", "CPATH", "C_INCLUDE_PATH", "CPLUS_INCLUDE_PATH",
+        "LIBRARY_PATH", "LD_LIBRARY_PATH", "PKG_CONFIG_PATH", "CC", "CXX", "CFLAGS", "CXXFLAGS", "LDFLAGS",
+        "SDKROOT", "DEVELOPER_DIR", "VSINSTALLDIR", "VCINSTALLDIR", "WindowsSdkDir", "MSYSTEM", "MINGW_PREFIX",
+    };
+    String s;
+    for (auto &v : vars)
+    {
+        s += v + "=";
+        if (auto e = getenv(v.c_str()))
+            s += e;
+        s += "\n";
+    }
+    return shorten_hash(blake2b_512(s), 16);
+}
+
+static String get_fast_path_header(const SwBuild &b)
+{
+    return to_string(normalize_path(fs::current_path())) + "\n"
+        + b.getSettings().getHash() + "\n"
+        + get_environment_hash();
+}
+
+path SwBuild::getFastPathFingerprintPath() const
+{
+    return getExecutionPlanPath() += ".json";
+}
+
+void SwBuild::saveFastPath(const ExecutionPlan &p) const
+{
+    auto fn = getFastPathFingerprintPath();
+    // never pair new plan with old fingerprint
+    error_code ec;
+    fs::remove(fn, ec);
+
+    nlohmann::json j;
+    j["header"] = get_fast_path_header(*this);
+    auto &files = j["files"];
+    auto add_file = [&files](const path &f)
+    {
+        files[to_string(normalize_path(f))] = get_file_stamp(f);
+    };
+
+    // configs
+    for (auto &i : inputs)
+    {
+        auto &s = i.getInput().getInput().getSpecification();
+        // no config, targets are guessed from directory contents
+        if (!s.dir.empty())
+            return;
+        for (auto &f : s.getFiles())
+        {
+            if (!f.empty())
+                add_file(f);
+        }
+    }
+    if (build_settings["lock_file"].isValue())
+        add_file(fs::u8path(build_settings["lock_file"].getValue()));
+
+    // loading
+    {
+        std::unique_lock lk(fast_path_deps_mutex);
+        for (auto &f : fast_path_deps)
+            add_file(f);
+    }
+
+    // resolving
+    auto &db = getContext().getLocalStorage().getPackagesDatabase().fn;
+    add_file(db);
+    add_file(path(db) += "-wal");
+
+    // toolchain
+    add_file(boost::dll::program_location().wstring());
+    Files outputs;
+    for (auto &c : p.getCommands())
+    {
+        auto &o = static_cast<builder::Command *>(c)->outputs;
+        outputs.insert(o.begin(), o.end());
+    }
+    for (auto &c : p.getCommands())
+    {
+        path prog = static_cast<builder::Command *>(c)->getProgram();
+        // programs built here change every time
+        if (prog.empty() || !prog.is_absolute() || outputs.contains(prog))
+            continue;
+        add_file(prog);
+    }
+
+    auto &dirs = j["dirs"];
+    {
+        std::unique_lock lk(globbed_dirs_mutex);
+        for (auto &[d, recursive] : globbed_dirs)
+        {
+            auto &jd = dirs[to_string(normalize_path(d))];
+            jd["recursive"] = recursive;
+            jd["hash"] = get_directory_listing_hash(d, recursive);
+        }
+    }
+
+    try
+    {
+        p.save(getExecutionPlanPath());
+        write_file(fn, j.dump(2));
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Cannot save fast path: " << e.what());
+    }
+}
+
+bool SwBuild::runFastPath()
+{
+    auto fn = getFastPathFingerprintPath();
+    auto epfn = getExecutionPlanPath();
+    if (!fs::exists(fn) || !fs::exists(epfn))
+        return false;
+
+    Commands cmds;
+    std::unique_ptr<ExecutionPlan> p;
+    try
+    {
+        auto j = nlohmann::json::parse(read_file(fn));
+        auto changed = [this, &j]() -> String
+        {
+            if (j["header"].get<String>() != get_fast_path_header(*this))
+                return "settings or environment";
+            for (auto &[f, stamp] : j["files"].items())
+            {
+                if (get_file_stamp(fs::u8path(f)) != stamp.get<String>())
+                    return f;
+            }
+            for (auto &[d, jd] : j["dirs"].items())
+            {
+                if (get_directory_listing_hash(fs::u8path(d), jd["recursive"].get<bool>()) != jd["hash"].get<String>())
+                    return d;
+            }
+            return {};
+        }();
+        if (!changed.empty())
+        {
+            LOG_DEBUG(logger, "Fast path is not used, changed: " << changed);
+            return false;
+        }
+        cmds = ExecutionPlan::load(epfn, *this);
+        p = ExecutionPlan::create(cmds);
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Fast path is not used: " << e.what());
+        return false;
+    }
+
+    LOG_DEBUG(logger, "Fast path: using saved execution plan " << normalize_path(epfn));
+    overrideBuildState(BuildState::Prepared);
+    execute(*p);
+    return true;
+}
+
 const std::vector<InputWithSettings> &SwBuild::getInputs() const
 {
     return inputs;
@@ -1276,6 +1782,15 @@ void SwBuild::setSettings(const TargetSettings &bs)
         build_executor = std::make_unique<Executor>(std::stoi(build_settings["build-jobs"].getValue()));
     if (build_settings["prepare-jobs"])
         prepare_executor = std::make_unique<Executor>(std::stoi(build_settings["prepare-jobs"].getValue()));
+
+    // only for packages of the main build
+    binary_cache.reset();
+    if (build_settings["master_build"] == "true"
+        && build_settings["binary_cache_dir"].isValue() && !build_settings["binary_cache_dir"].getValue().empty())
+    {
+        binary_cache = std::make_unique<BinaryCache>(
+            fs::u8path(build_settings["binary_cache_dir"].getValue()), getContext().getLocalStorage().storage_dir);
+    }
 }
 
 Executor &SwBuild::getBuildExecutor() const
@@ -10,6 +10,7 @@
 namespace sw
 {
 
+struct BinaryCache;
 struct ExecutionPlan;
 struct Input;
 struct InputWithSettings;
@@ -101,6 +102,17 @@ struct SW_CORE_API SwBuild : SwBuilderContext
     void setName(const String &);
     String getName() const; // returns temporary object, so no refs
 
+    /// all users of shared precompiled header register here during prepare,
+    /// the smallest target id is the owner, it builds header for all others
+    void registerSharedPrecompiledHeader(const String &key, const String &target) const;
+    /// valid after prepare
+    String getSharedPrecompiledHeaderOwner(const String &key) const;
+
+    /// globbed directories are checked by fast path
+    void addGlobbedDirectory(const path &dir, bool recursive) const;
+    /// files read while loading packages (templates, checks, config deps) are checked by fast path
+    void addFastPathDependency(const path &) const;
+
 private:
     SwContext &swctx;
     path build_dir;
@@ -115,6 +127,13 @@ private:
     bool stopped = false;
     mutable ExecutionPlan *current_explan = nullptr;
     Files explan_files;
+    std::unique_ptr<BinaryCache> binary_cache;
+    mutable std::unordered_map<String, String> shared_pchs;
+    mutable std::mutex shared_pchs_mutex;
+    mutable std::map<path, bool> globbed_dirs;
+    mutable std::mutex globbed_dirs_mutex;
+    mutable FilesSorted fast_path_deps;
+    mutable std::mutex fast_path_deps_mutex;
 
     // other data
     String name;
@@ -127,6 +146,9 @@ private:
     void resolvePackages(const std::vector<IDependency*> &upkgs); // [2/2] step
     Executor &getBuildExecutor() const;
     Executor &getPrepareExecutor() const;
+    path getFastPathFingerprintPath() const;
+    bool runFastPath();
+    void saveFastPath(const ExecutionPlan &) const;
 };
 
 } // namespace sw
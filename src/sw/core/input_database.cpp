@@ -11,7 +11,11 @@
 #include <sqlpp11/sqlite3/sqlite3.h>
 #include <sqlpp11/sqlpp11.h>
 
+#include <boost/algorithm/string.hpp>
+#include <primitives/hash.h>
+
 #include <string.h> // memcpy
+#include <thread>
 
 namespace sw
 {
@@ -21,47 +25,143 @@ InputDatabase::InputDatabase(const path &p)
 {
 }
 
+// first 64 bits of blake2b, fixed byte order
+static size_t get_strong_file_hash(const path &p)
+{
+    return std::stoull(strong_file_hash_file(p).substr(0, 16), nullptr, 16);
+}
+
 size_t InputDatabase::getFileHash(const path &p) const
+{
+    return getFileHashes({ p })[0];
+}
+
+std::vector<size_t> InputDatabase::getFileHashes(const std::vector<path> &files) const
 {
     const ::db::inputs::File file{};
 
-    bool update_db = false;
-    auto lwt = fs::last_write_time(p);
-    auto np = to_string(normalize_path(p));
+    struct Data
+    {
+        String np;
+        fs::file_time_type lwt;
+        std::optional<std::vector<uint8_t>> old_lwt; // row exists
+        std::optional<size_t> h;
+    };
 
-    auto q = (*db)(
-        select(file.hash, file.lastWriteTime)
-        .from(file)
-        .where(file.path == np));
-    if (!q.empty())
+    std::vector<Data> data(files.size());
+    std::unordered_map<String, std::vector<size_t>> idx; // paths are case insensitive in db
+    for (size_t i = 0; i < files.size(); i++)
     {
-        if (memcmp(q.front().lastWriteTime.value().data(), &lwt, sizeof(lwt)) == 0)
-            return q.front().hash.value();
-        update_db = true;
+        data[i].np = to_string(normalize_path(files[i]));
+        data[i].lwt = fs::last_write_time(files[i]);
+        idx[boost::to_lower_copy(data[i].np)].push_back(i);
     }
 
-    auto c = read_file(p);
-    auto h = std::hash<String>()(c);
-
-    std::vector<uint8_t> lwtdata(sizeof(lwt));
-    memcpy(lwtdata.data(), &lwt, lwtdata.size());
-    if (update_db)
+    db->execute("SAVEPOINT input_hashes;");
+    try
     {
-        (*db)(update(file).set(
-            file.hash = h,
-            file.lastWriteTime = lwtdata
-        ).where(file.path == np));
+        // select known files
+        const size_t chunk = 500;
+        for (size_t i = 0; i < data.size(); i += chunk)
+        {
+            std::vector<String> nps;
+            for (size_t j = i; j < std::min(data.size(), i + chunk); j++)
+                nps.push_back(data[j].np);
+            for (const auto &row : (*db)(
+                select(file.path, file.hash, file.lastWriteTime)
+                .from(file)
+                .where(file.path.in(sqlpp::value_list(nps)))))
+            {
+                auto it = idx.find(boost::to_lower_copy(row.path.value()));
+                if (it == idx.end())
+                    continue;
+                for (auto k : it->second)
+                {
+                    auto &d = data[k];
+                    d.old_lwt = row.lastWriteTime.value();
+                    if (d.old_lwt->size() == sizeof(d.lwt) && memcmp(d.old_lwt->data(), &d.lwt, sizeof(d.lwt)) == 0)
+                        d.h = row.hash.value();
+                }
+            }
+        }
+
+        // hash new and changed files
+        std::vector<size_t> todo;
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            if (!data[i].h)
+                todo.push_back(i);
+        }
+        {
+            std::atomic_size_t next = 0;
+            std::exception_ptr eptr;
+            std::mutex m;
+            auto worker = [&]()
+            {
+                for (size_t i; (i = next++) < todo.size();)
+                {
+                    try
+                    {
+                        data[todo[i]].h = get_strong_file_hash(files[todo[i]]);
+                    }
+                    catch (...)
+                    {
+                        std::unique_lock lk(m);
+                        eptr = std::current_exception();
+                    }
+                }
+            };
+            std::vector<std::thread> threads;
+            auto nthreads = std::min<size_t>(todo.size(), std::thread::hardware_concurrency());
+            for (size_t i = 1; i < nthreads; i++)
+                threads.emplace_back(worker);
+            worker();
+            for (auto &t : threads)
+                t.join();
+            if (eptr)
+                std::rethrow_exception(eptr);
+        }
+
+        // store
+        for (auto i : todo)
+        {
+            auto &d = data[i];
+            std::vector<uint8_t> lwtdata(sizeof(d.lwt));
+            memcpy(lwtdata.data(), &d.lwt, lwtdata.size());
+            if (d.old_lwt)
+            {
+                (*db)(update(file).set(
+                    file.hash = *d.h,
+                    file.lastWriteTime = lwtdata
+                ).where(file.path == d.np));
+            }
+            else
+            {
+                (*db)(insert_into(file).set(
+                    file.path = d.np,
+                    file.hash = *d.h,
+                    file.lastWriteTime = lwtdata
+                ));
+                // same file requested twice
+                d.old_lwt = lwtdata;
+                for (auto k : idx[boost::to_lower_copy(d.np)])
+                    data[k].old_lwt = lwtdata;
+            }
+        }
     }
-    else
+    catch (...)
     {
-        (*db)(insert_into(file).set(
-            file.path = np,
-            file.hash = h,
-            file.lastWriteTime = lwtdata
-        ));
+        db->execute("ROLLBACK TO input_hashes;");
+        db->execute("RELEASE input_hashes;");
+        throw;
     }
+    db->execute("RELEASE input_hashes;");
 
-    return h;
+    std::vector<size_t> hashes;
+    hashes.reserve(data.size());
+    for (auto &d : data)
+        hashes.push_back(*d.h);
+    return hashes;
 }
 
 } // namespace sw
@@ -17,6 +17,11 @@ struct SW_CORE_API InputDatabase : Database
     InputDatabase(const path &dbfn);
 
     size_t getFileHash(const path &) const;
+
+    /// returns hashes in the same order
+    /// uses one transaction for all files, changed files are hashed in parallel
+    /// hash is strong and does not depend on platform or standard library
+    std::vector<size_t> getFileHashes(const std::vector<path> &) const;
 };
 
 } // namespace sw
@@ -30,6 +30,13 @@ CREATE UNIQUE INDEX ux_file ON file (path ASC);
 --
 --------------------------------------------------------------------------------
 
+--------------------------------------------------------------------------------
+-- %split
+--------------------------------------------------------------------------------
+
+-- hashes are blake2b based now, drop old std::hash values
+DELETE FROM file;
+
 --------------------------------------------------------------------------------
 -- % split - merge '%' and 'split' together when patches are available
 --------------------------------------------------------------------------------
@@ -25,7 +25,17 @@ size_t Specification::getHash(const InputDatabase &db) const
     if (!dir.empty())
         return std::hash<path>()(dir);
 
+    // query all files at once
+    std::vector<path> fns;
+    for (auto &[rel, f] : files.getData())
+    {
+        if (!f.absolute_path.empty())
+            fns.push_back(f.absolute_path);
+    }
+    auto hashes = db.getFileHashes(fns);
+
     size_t h = 0;
+    size_t i = 0;
     for (auto &[rel, f] : files.getData())
     {
         if (f.absolute_path.empty())
@@ -35,7 +45,7 @@ size_t Specification::getHash(const InputDatabase &db) const
             continue;
         }
 
-        hash_combine(h, db.getFileHash(f.absolute_path));
+        hash_combine(h, hashes[i++]);
     }
     return h;
 }
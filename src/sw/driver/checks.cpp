@@ -184,6 +184,252 @@ void ChecksStorage::add(const Check &c)
     all_checks[h] = c.Value.value();
 }
 
+// shared check results
+// record: '<config> <check hash> <value> <digest>'
+// config covers settings (compiler package, flags), compiler contents and sysroot,
+// check hash covers check definition,
+// so records are valid on any machine with identical toolchain
+
+struct CheckRecord
+{
+    String config;
+    size_t hash;
+    CheckValue value;
+};
+
+static String get_check_record_digest(const String &config, size_t h, CheckValue v)
+{
+    return shorten_hash(blake2b_512(config + " " + std::to_string(h) + " " + std::to_string(v)), 16);
+}
+
+static String make_check_record(const String &config, size_t h, CheckValue v)
+{
+    return config + " " + std::to_string(h) + " " + std::to_string(v) + " " + get_check_record_digest(config, h, v);
+}
+
+static std::optional<CheckRecord> parse_check_record(const String &line)
+{
+    auto v = split_string(boost::trim_copy(line), " ");
+    if (v.size() != 4)
+        return {};
+    CheckRecord r;
+    try
+    {
+        r.config = v[0];
+        r.hash = std::stoull(v[1]);
+        r.value = std::stoi(v[2]);
+    }
+    catch (std::exception &)
+    {
+        return {};
+    }
+    if (get_check_record_digest(r.config, r.hash, r.value) != v[3])
+        return {};
+    return r;
+}
+
+static path get_checks_file(const path &checks_dir, const String &config)
+{
+    return checks_dir / config / "checks.3.txt";
+}
+
+// read-through directory, one file per check: <dir>/<config>/<check hash>
+static std::optional<CheckValue> find_shared_check(const path &dir, const String &config, size_t h)
+{
+    auto fn = dir / config / std::to_string(h);
+    if (!fs::exists(fn))
+        return {};
+    auto r = parse_check_record(read_file(fn));
+    if (!r || r->config != config || r->hash != h)
+    {
+        LOG_WARN(logger, "Ignoring corrupted check record: " + to_string(fn.u8string()));
+        return {};
+    }
+    return r->value;
+}
+
+static void add_shared_check(const path &dir, const String &config, size_t h, CheckValue v)
+{
+    auto fn = dir / config / std::to_string(h);
+    if (fs::exists(fn))
+        return;
+    // directory may be read only or shared, so do not fail the build
+    try
+    {
+        // readers must not see partial records
+        auto tmp = path(fn) += "." + to_string(unique_path().u8string()) + ".tmp";
+        write_file(tmp, make_check_record(config, h, v) + "\n");
+        std::error_code ec;
+        fs::rename(tmp, fn, ec);
+        if (ec)
+            fs::remove(tmp, ec);
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Cannot save shared check: " << e.what());
+    }
+}
+
+// bundle records are keyed by toolchain config (settings + toolchain hash)
+static const std::map<String, std::vector<CheckRecord>> &read_checks_bundle(const path &fn)
+{
+    static std::map<path, std::map<String, std::vector<CheckRecord>>> bundles;
+    auto i = bundles.find(fn);
+    if (i != bundles.end())
+        return i->second;
+
+    auto &records = bundles[fn];
+    size_t bad = 0;
+    for (auto &l : read_lines(fn))
+    {
+        if (l.empty() || l[0] == '#')
+            continue;
+        if (auto r = parse_check_record(l))
+            records[r->config].push_back(*r);
+        else
+            bad++;
+    }
+    if (bad)
+        LOG_WARN(logger, "Ignoring " << bad << " corrupted record(s) in checks bundle: " + to_string(fn.u8string()));
+    return records;
+}
+
+// merges records of this toolchain into local storage of settings config
+static void import_checks_bundle(const path &fn, const String &config, const String &shared_config, ChecksStorage &cs, const path &cfn)
+{
+    static std::mutex m;
+    static std::set<std::pair<path, String>> imported;
+    std::unique_lock lk(m);
+    if (!imported.emplace(fn, shared_config).second)
+        return;
+
+    auto &records = read_checks_bundle(fn);
+    auto i = records.find(shared_config);
+    if (i == records.end())
+    {
+        // same settings, but other compiler or sysroot
+        auto j = records.lower_bound(config);
+        if (j != records.end() && j->first.rfind(config, 0) == 0)
+            LOG_WARN(logger, "Skipping checks for config " + config + " from " + to_string(fn.u8string()) + ": toolchain does not match");
+        return;
+    }
+
+    size_t added = 0;
+    for (auto &r : i->second)
+        added += cs.all_checks.emplace(r.hash, r.value).second;
+    if (added)
+        cs.save(cfn);
+    LOG_DEBUG(logger, "Imported " << added << " check(s) from " + to_string(fn.u8string()));
+}
+
+struct ChecksExports
+{
+    std::mutex m;
+    std::set<path> files;
+    // settings config -> toolchain config
+    std::map<String, String> configs;
+};
+
+static ChecksExports &get_checks_exports()
+{
+    static ChecksExports e;
+    return e;
+}
+
+static void schedule_checks_export(const path &fn, const String &config, const String &shared_config)
+{
+    auto &e = get_checks_exports();
+    std::unique_lock lk(e.m);
+    e.files.insert(fn);
+    e.configs[config] = shared_config;
+}
+
+// writes checks of all configs scheduled for export
+void export_checks_bundles()
+{
+    auto &e = get_checks_exports();
+    std::unique_lock lk(e.m);
+    for (auto &fn : e.files)
+    {
+        String s = "# sw checks bundle\n";
+        for (auto &[config, shared_config] : e.configs)
+        {
+            auto i = getChecksStorages().find(config);
+            if (i == getChecksStorages().end())
+                continue;
+            auto &cs = *i->second;
+            for (auto &[h, v] : std::map<size_t, CheckValue>(cs.all_checks.begin(), cs.all_checks.end()))
+                s += make_check_record(shared_config, h, v) + "\n";
+        }
+        if (fn.has_parent_path())
+            fs::create_directories(fn.parent_path());
+        write_file(fn, s);
+        LOG_DEBUG(logger, "Exported checks to " + to_string(fn.u8string()));
+    }
+    e.files.clear();
+}
+
+// compilers may be replaced in place and sdk may be switched without any settings change,
+// so shared records also depend on compiler contents and sysroot
+static String get_toolchain_hash(const NativeCompiledTarget &t, const TargetSettings &ts)
+{
+    static std::mutex m;
+    static std::map<std::pair<path, fs::file_time_type>, String> program_hashes;
+    static std::map<String, String> sysroots;
+
+    auto run = [](const Strings &args)
+    {
+        primitives::Command c;
+        for (auto &a : args)
+            c.push_back(a);
+        std::error_code ec;
+        c.execute(ec);
+        return ec ? String{} : boost::trim_copy(c.out.text);
+    };
+
+    String s;
+    for (auto &ext : { ".c", ".cpp" })
+    {
+        auto p = t.findProgramByExtension(ext);
+        if (!p || p->file.empty() || !fs::exists(p->file))
+            continue;
+        auto k = std::pair{ p->file, fs::last_write_time(p->file) };
+        std::unique_lock lk(m);
+        auto i = program_hashes.find(k);
+        if (i == program_hashes.end())
+            i = program_hashes.emplace(k, strong_file_hash_file(p->file)).first;
+        s += to_string(normalize_path(p->file)) + " " + i->second + "\n";
+
+        if (t.getCompilerType() == CompilerType::GNU)
+        {
+            auto &sr = sysroots[to_string(normalize_path(p->file))];
+            if (sr.empty())
+                sr = "sysroot: " + run({ to_string(p->file.u8string()), "-print-sysroot" });
+            s += sr + "\n";
+        }
+    }
+
+    if (auto e = getenv("SDKROOT"))
+        s += String("SDKROOT: ") + e + "\n";
+    // sdk symlinks point to versioned dirs
+    auto os = BuildSettings(ts).TargetOS;
+    if (os.isApple())
+    {
+        auto sdk = os.is(OSType::IOS) ? "iphoneos" : "macosx";
+        std::unique_lock lk(m);
+        auto &sr = sysroots[sdk];
+        if (sr.empty())
+        {
+            path p = run({ "xcrun", "--sdk", sdk, "--show-sdk-path" });
+            std::error_code ec;
+            sr = "sdk: " + to_string(normalize_path(fs::exists(p) ? fs::canonical(p, ec) : p));
+        }
+        s += sr + "\n";
+    }
+    // windows sdk and other system libs are packages, their versions are in settings already
+    return shorten_hash(blake2b_512(s), 8);
+}
+
 static String make_function_var(const String &d, const String &prefix = "HAVE_", const String &suffix = {})
 {
     return prefix + boost::algorithm::to_upper_copy(d) + suffix;
@@ -268,14 +514,55 @@ void CheckSet::performChecks(const SwBuild &mb, const TargetSettings &ts)
     std::unique_lock lk(*m2);
     //std::unique_lock lk2(m);*/
 
-    auto fn = checks_dir / config / "checks.3.txt";
+    auto get_setting = [&mb](const String &k) -> String
+    {
+        auto &s = mb.getSettings()[k];
+        return s.isValue() ? s.getValue() : String{};
+    };
+
+    const path shared_dir = get_setting("checks_cache_dir");
+    const path import_fn = get_setting("checks_import");
+    const path export_fn = get_setting("checks_export");
+    // local storage is per settings, shared dir and bundles are per toolchain too
+    String shared_config;
+    if (!shared_dir.empty() || !import_fn.empty() || !export_fn.empty())
+        shared_config = config + "-" + get_toolchain_hash(*t, ts);
+
+    auto fn = get_checks_file(checks_dir, config);
     auto &cs = getChecksStorage(config, fn);
+    // results are read from there on the next run
+    mb.addFastPathDependency(fn);
+    mb.addFastPathDependency(path(fn) += MANUAL_CHECKS);
+
+    if (!import_fn.empty())
+    {
+        mb.addFastPathDependency(import_fn);
+        import_checks_bundle(import_fn, config, shared_config, cs, fn);
+    }
+    if (!export_fn.empty())
+        schedule_checks_export(export_fn, config, shared_config);
 
     // add common checks
     testBigEndian();
+    bool shared_loaded = false;
+    auto find_value = [&cs, &shared_config, &shared_dir, &shared_loaded](size_t h) -> std::optional<CheckValue>
+    {
+        auto i = cs.all_checks.find(h);
+        if (i != cs.all_checks.end())
+            return i->second;
+        if (shared_dir.empty())
+            return {};
+        auto v = find_shared_check(shared_dir, shared_config, h);
+        if (v)
+        {
+            cs.all_checks[h] = *v;
+            shared_loaded = true;
+        }
+        return v;
+    };
 
     // returns true if inserted
-    auto add_dep = [this, &cs](auto &c)
+    auto add_dep = [this, &find_value](auto &c)
     {
         auto h = c->getHash();
         auto ic = checks.find(h);
@@ -287,17 +574,15 @@ void CheckSet::performChecks(const SwBuild &mb, const TargetSettings &ts)
 
             // maybe we already know it?
             // this path is used with wait_for_cc_checks
-            auto i = cs.all_checks.find(h);
-            if (i != cs.all_checks.end())
-                ic->second->Value = i->second;
+            if (auto v = find_value(h))
+                ic->second->Value = v;
 
             return std::pair{ false, ic->second };
         }
         checks[h] = c;
 
-        auto i = cs.all_checks.find(h);
-        if (i != cs.all_checks.end())
-            c->Value = i->second;
+        if (auto v = find_value(h))
+            c->Value = v;
         return std::pair{ true, c };
     };
 
@@ -365,11 +650,22 @@ void CheckSet::performChecks(const SwBuild &mb, const TargetSettings &ts)
 
     if (unchecked.empty())
     {
-        if (cs.new_manual_checks_loaded)
+        if (cs.new_manual_checks_loaded || shared_loaded)
             cs.save(fn);
         return;
     }
 
+    auto publish = [&shared_dir, &shared_config, &unchecked]()
+    {
+        if (shared_dir.empty())
+            return;
+        for (auto &c : unchecked)
+        {
+            if (c->Value && !c->requires_manual_setup)
+                add_shared_check(shared_dir, shared_config, c->getHash(), *c->Value);
+        }
+    };
+
     auto ep = ExecutionPlan::create(unchecked);
     if (ep)
     {
@@ -400,11 +696,13 @@ void CheckSet::performChecks(const SwBuild &mb, const TargetSettings &ts)
                     cs.add(*c);
             }
             cs.save(fn);
+            publish();
             throw;
         }
 
         for (auto &[h, c] : checks)
             cs.add(*c);
+        publish();
 
         auto cc_dir = fn.parent_path() / "cc";
 
@@ -371,4 +371,7 @@ private:
     std::unordered_map<size_t /* hash */, CheckPtr> checks;
 };
 
+// writes bundles requested by checks_export setting
+void export_checks_bundles();
+
 }
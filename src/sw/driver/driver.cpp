@@ -8,6 +8,7 @@
 #include "driver.h"
 
 #include "build.h"
+#include "checks.h"
 #include "suffix.h"
 #include "target/all.h"
 #include "entry_point.h"
@@ -147,6 +148,11 @@ void Driver::processConfigureAc(const path &p)
     process_configure_ac2(p);
 }
 
+void Driver::exportChecks()
+{
+    export_checks_bundles();
+}
+
 struct DriverInput
 {
     FrontendType fe_type = FrontendType::Unspecified;
@@ -188,7 +194,7 @@ struct SpecFileInput : Input, DriverInput
         case FrontendType::SwC:
         {
             auto out = static_cast<const Driver&>(getDriver()).build_configs1(swctx, { this }).begin()->second;
-            module = loadSharedLibrary(out.dll, out.PATH, swctx.getSettings()["do_not_remove_bad_module"] == "true");
+            module = loadSharedLibrary(out.dll, out.PATH, swctx.getSettings()["do_not_remove_bad_module"] == "true", out.entry_point_suffix);
             auto ep = std::make_unique<NativeModuleTargetEntryPoint>(*module);
             set_source_dir(ep, fn);
             return ep;
@@ -472,6 +478,9 @@ void Driver::loadInputsBatch(const std::set<Input *> &inputs) const
         m[i2->getSpecification().files.getData().begin()->second.absolute_path] = i;
     }
 
+    bool do_not_remove_bad_module = swctx.getSettings()["do_not_remove_bad_module"] == "true";
+    // many configs may live in one dll, load it once
+    std::unordered_map<path, std::shared_ptr<Module::DynamicLibrary>> dlls;
     for (auto &[p, out] : build_configs1(swctx, inputs))
     {
         auto i = dynamic_cast<SpecFileInput *>(m[p]);
@@ -480,7 +489,10 @@ void Driver::loadInputsBatch(const std::set<Input *> &inputs) const
             LOG_WARN(logger, "Bad input");
             continue;
         }
-        i->module = loadSharedLibrary(out.dll, out.PATH, swctx.getSettings()["do_not_remove_bad_module"] == "true");
+        auto &dl = dlls[out.dll];
+        if (!dl)
+            dl = loadDynamicLibrary(out.dll, out.PATH, do_not_remove_bad_module);
+        i->module = std::make_unique<Module>(dl, do_not_remove_bad_module, out.entry_point_suffix);
         auto ep = std::make_unique<NativeModuleTargetEntryPoint>(*i->module);
         ep->source_dir = p.parent_path();
         if (!i->source_dir.empty())
@@ -608,8 +620,8 @@ std::unordered_map<path, PrepareConfigOutputData> Driver::build_configs1(SwConte
     //                                                        load all our known targets
     auto b2 = ep.createBuild(*b, getDllConfigSettings(swctx), getBuiltinPackages(ctx), {});
     PrepareConfig pc;
-    for (auto &i : inputs)
-        pc.addInput(b2, *i);
+    pc.many2one = swctx.getSettings()["configs_many2one"] == "true";
+    pc.addInputs(b2, inputs);
 
     // fast path
     if (swctx.getSettings()["ignore_outdated_configs"] == "true" || !pc.isOutdated())
@@ -632,6 +644,7 @@ std::unordered_map<path, PrepareConfigOutputData> Driver::build_configs1(SwConte
         b->loadPackages();
         b->prepare();
         b->execute();
+        pc.saveConfigFiles();
     }
 
     for (auto &tgt : tgts)
@@ -40,6 +40,8 @@ struct SW_DRIVER_CPP_API Driver : IDriver
 
     // this driver own api
     static void processConfigureAc(const path &p);
+    // writes requested checks bundles, call when all builds are done
+    static void exportChecks();
 
     // IDriver api
     void loadInputsBatch(const std::set<Input *> &) const override;
@@ -272,6 +272,21 @@ static std::pair<FilesOrdered, UnresolvedPackages> getFileDependencies(const SwC
     return getFileDependencies(swctx, in_config_file, gns);
 }
 
+static bool has_includes(const path &fn)
+{
+    for (auto &l : split_lines(read_file(fn)))
+    {
+        if (boost::starts_with(boost::trim_copy(l), "#include"))
+            return true;
+    }
+    return false;
+}
+
+static String getEntryPointSuffix(const path &fn)
+{
+    return "_" + shorten_hash(sha1(to_string(normalize_path(fn))), 8);
+}
+
 Build NativeTargetEntryPoint::createBuild(SwBuild &swb, const TargetSettings &s, const PackageIdSet &pkgs, const PackagePath &prefix) const
 {
     // we need to fix some settings before they go to targets
@@ -336,6 +351,15 @@ NativeModuleTargetEntryPoint::NativeModuleTargetEntryPoint(const Module &m)
 
 void NativeModuleTargetEntryPoint::loadPackages1(Build &b) const
 {
+    // config and everything it was built from
+    auto dll = m.getLocation();
+    b.getMainBuild().addFastPathDependency(dll);
+    if (auto fn = getConfigFilesList(dll); fs::exists(fn))
+    {
+        for (auto &f : read_lines(fn))
+            b.getMainBuild().addFastPathDependency(fs::u8path(f));
+    }
+
     m.check(b, b.checker);
     m.build(b);
 }
@@ -375,7 +399,7 @@ static void addDeps(Build &solution, NativeCompiledTarget &lib)
     //d->GenerateCommandsBefore = true;
 }
 
-void PrepareConfig::addInput(Build &b, const Input &i)
+PrepareConfig::InputData PrepareConfig::getInputData(const Input &i)
 {
     InputData d;
     auto files = i.getSpecification().getFiles();
@@ -398,13 +422,73 @@ void PrepareConfig::addInput(Build &b, const Input &i)
     else
         lang = LANG_CPP;
         //SW_UNIMPLEMENTED;
-    r[d.fn].dll = one2one(b, d);
-    if (fs::exists(r[d.fn].dll))
-        inputs_outdated |= i.isOutdated(fs::last_write_time(r[d.fn].dll));
+    return d;
+}
+
+void PrepareConfig::setInputOutdated(const Input &i, const path &dll)
+{
+    if (fs::exists(dll))
+        inputs_outdated |= i.isOutdated(fs::last_write_time(dll));
     else
         inputs_outdated = true;
 }
 
+void PrepareConfig::addInput(Build &b, const Input &i)
+{
+    auto d = getInputData(i);
+    r[d.fn].dll = one2one(b, d);
+    setInputOutdated(i, r[d.fn].dll);
+}
+
+void PrepareConfig::addInputs(Build &b, const std::set<Input *> &inputs)
+{
+    if (!many2one)
+    {
+        for (auto &i : inputs)
+            addInput(b, *i);
+        return;
+    }
+
+    std::vector<std::pair<const Input *, InputData>> batch;
+    for (auto &i : inputs)
+    {
+        auto d = getInputData(*i);
+        // local configs are changed often, so they are kept in their own dlls
+        // '#pragma sw require header' brings code that cannot be linked twice
+        // includes cannot be placed into config namespace
+        if (lang != LANG_CPP
+            || !is_under_root(d.fn, b.getContext().getLocalStorage().storage_dir)
+            || !getFileDependencies(b.getContext(), d.fn).first.empty()
+            || has_includes(d.fn))
+        {
+            r[d.fn].dll = one2one(b, d);
+            setInputOutdated(*i, r[d.fn].dll);
+            continue;
+        }
+        batch.emplace_back(i, d);
+    }
+    if (batch.empty())
+        return;
+
+    // group membership depends only on file name,
+    // so adding, removing or changing a config relinks only its group
+    static const size_t config_groups = 16;
+    std::map<size_t, std::vector<std::pair<const Input *, InputData>>> groups;
+    for (auto &v : batch)
+        groups[std::stoull(getEntryPointSuffix(v.second.fn).substr(1), nullptr, 16) % config_groups].push_back(v);
+
+    lang = LANG_CPP;
+    for (auto &[g, group] : groups)
+    {
+        std::vector<InputData> data;
+        for (auto &[_, d] : group)
+            data.push_back(d);
+        auto dll = many2one(b, data);
+        for (auto &[i, d] : group)
+            setInputOutdated(*i, dll);
+    }
+}
+
 template <class T>
 struct ConfigSharedLibraryTarget : T
 {
@@ -462,9 +546,8 @@ private:
     }
 };
 
-SharedLibraryTarget &PrepareConfig::createTarget(Build &b, const InputData &d)
+SharedLibraryTarget &PrepareConfig::createTarget(Build &b, const InputData &d, const PackagePath &name)
 {
-    auto name = getSelfTargetName(b, { d.fn });
     Version v(0, 0, ::sw_get_module_abi_version());
     auto &lib =
         lang == LANG_VALA
@@ -475,13 +558,13 @@ SharedLibraryTarget &PrepareConfig::createTarget(Build &b, const InputData &d)
     return lib;
 }
 
-decltype(auto) PrepareConfig::commonActions(Build &b, const InputData &d, const UnresolvedPackages &deps)
+decltype(auto) PrepareConfig::commonActions(Build &b, const InputData &d, const UnresolvedPackages &deps, const PackagePath &name)
 {
     // save udeps
     //udeps = deps;
 
     auto &fn = d.fn;
-    auto &lib = createTarget(b, d);
+    auto &lib = createTarget(b, d, name.empty() ? getSelfTargetName(b, { d.fn }) : name);
     lib.GenerateWindowsResource = false;
     lib.command_storage = &getDriverCommandStorage(b);
 
@@ -560,92 +643,41 @@ decltype(auto) PrepareConfig::commonActions(Build &b, const InputData &d, const
     return lib;
 }
 
-// one input file to one dll
-path PrepareConfig::one2one(Build &b, const InputData &d)
+static void addForcedIncludes(NativeCompiledTarget &lib, const path &fn, const FilesOrdered &files)
 {
-    auto &fn = d.cfn;
-    auto [headers, udeps] = getFileDependencies(b.getContext(), fn);
-
-    auto &lib = commonActions(b, d, udeps);
-
-    // turn on later again
-    //if (lib.getSettings().TargetOS.is(OSType::Windows))
-        //lib += "_CRT_SECURE_NO_WARNINGS"_def;
-
-    // file deps
+    auto sf = lib[fn].template as<NativeSourceFile *>();
+    if (!sf)
+        return;
+    if (auto c = sf->compiler->template as<VisualStudioCompiler *>())
     {
-        for (auto &h : headers)
-        {
-            // TODO: refactor this and same cases below
-            if (auto sf = lib[fn].template as<NativeSourceFile *>())
-            {
-                if (auto c = sf->compiler->template as<VisualStudioCompiler *>())
-                {
-                    c->ForcedIncludeFiles().push_back(h);
-                }
-                else if (auto c = sf->compiler->template as<ClangClCompiler *>())
-                {
-                    c->ForcedIncludeFiles().push_back(h);
-                }
-                else if (auto c = sf->compiler->template as<ClangCompiler *>())
-                {
-                    c->ForcedIncludeFiles().push_back(h);
-                }
-                else if (auto c = sf->compiler->template as<GNUCompiler *>())
-                {
-                    c->ForcedIncludeFiles().push_back(h);
-                }
-            }
-        }
-        // sort deps first!
-        for (auto &d : std::set<UnresolvedPackage>(udeps.begin(), udeps.end()))
-            lib += std::make_shared<Dependency>(d);
+        for (auto &f : files)
+            c->ForcedIncludeFiles().push_back(f);
+
+        // deprecated warning
+        // activate later
+        // this causes cl warning (PCH is built without it)
+        // we must build two PCHs? for storage pks and local pkgs
+        //c->Warnings().TreatAsError.push_back(4996);
     }
-
-    FilesOrdered fi_files;
-    if (lang == LANG_CPP)
+    else if (auto c = sf->compiler->template as<ClangClCompiler *>())
     {
-        fi_files.push_back(driver_idir / getSw1Header());
-        fi_files.push_back(driver_idir / getSwCheckAbiVersionHeader());
+        for (auto &f : files)
+            c->ForcedIncludeFiles().push_back(f);
     }
-    else
+    else if (auto c = sf->compiler->template as<ClangCompiler *>())
     {
-        fi_files.push_back(driver_idir / getSwDir() / "c" / "c.h"); // main include, goes first
-        fi_files.push_back(driver_idir / getSwDir() / "c" / "swc.h");
-        fi_files.push_back(driver_idir / getSwCheckAbiVersionHeader()); // TODO: remove it, we don't need abi here
+        for (auto &f : files)
+            c->ForcedIncludeFiles().push_back(f);
     }
-
-    if (auto sf = lib[fn].template as<NativeSourceFile*>())
+    else if (auto c = sf->compiler->template as<GNUCompiler *>())
     {
-        if (auto c = sf->compiler->template as<VisualStudioCompiler*>())
-        {
-            for (auto &f : fi_files)
-                c->ForcedIncludeFiles().push_back(f);
-
-            // deprecated warning
-            // activate later
-            // this causes cl warning (PCH is built without it)
-            // we must build two PCHs? for storage pks and local pkgs
-            //c->Warnings().TreatAsError.push_back(4996);
-        }
-        else if (auto c = sf->compiler->template as<ClangClCompiler*>())
-        {
-            for (auto &f : fi_files)
-                c->ForcedIncludeFiles().push_back(f);
-        }
-        else if (auto c = sf->compiler->template as<ClangCompiler*>())
-        {
-            for (auto &f : fi_files)
-                c->ForcedIncludeFiles().push_back(f);
-        }
-        else if (auto c = sf->compiler->template as<GNUCompiler*>())
-        {
-            for (auto &f : fi_files)
-                c->ForcedIncludeFiles().push_back(f);
-        }
+        for (auto &f : files)
+            c->ForcedIncludeFiles().push_back(f);
     }
+}
 
-    //commonActions2
+void PrepareConfig::commonActions2(Build &b, SharedLibraryTarget &lib)
+{
     if (lib.getBuildSettings().TargetOS.is(OSType::Windows))
     {
         lib.Definitions["SW_SUPPORT_API"] = "__declspec(dllimport)";
@@ -686,10 +718,177 @@ path PrepareConfig::one2one(Build &b, const InputData &d)
                                           // cannot be ignored https://docs.microsoft.com/en-us/cpp/build/reference/ignore-ignore-specific-warnings?view=vs-2017
                                           //L->IgnoreWarnings().insert(4088); // warning LNK4088: image being generated due to /FORCE option; image may not run
     }
+}
+
+// one input file to one dll
+path PrepareConfig::one2one(Build &b, const InputData &d)
+{
+    auto &fn = d.cfn;
+    auto [headers, udeps] = getFileDependencies(b.getContext(), fn);
+
+    auto &lib = commonActions(b, d, udeps);
+
+    // turn on later again
+    //if (lib.getSettings().TargetOS.is(OSType::Windows))
+        //lib += "_CRT_SECURE_NO_WARNINGS"_def;
+
+    // file deps
+    {
+        addForcedIncludes(lib, fn, headers);
+        // sort deps first!
+        for (auto &d : std::set<UnresolvedPackage>(udeps.begin(), udeps.end()))
+            lib += std::make_shared<Dependency>(d);
+    }
+
+    FilesOrdered fi_files;
+    if (lang == LANG_CPP)
+    {
+        fi_files.push_back(driver_idir / getSw1Header());
+        fi_files.push_back(driver_idir / getSwCheckAbiVersionHeader());
+    }
+    else
+    {
+        fi_files.push_back(driver_idir / getSwDir() / "c" / "c.h"); // main include, goes first
+        fi_files.push_back(driver_idir / getSwDir() / "c" / "swc.h");
+        fi_files.push_back(driver_idir / getSwCheckAbiVersionHeader()); // TODO: remove it, we don't need abi here
+    }
+    addForcedIncludes(lib, fn, fi_files);
+
+    commonActions2(b, lib);
 
     return lib.getOutputFile();
 }
 
+// config is compiled in its own namespace, so its helpers do not clash with other configs in the dll,
+// and its entry points are exported through wrappers with unique names
+static path writeEntryPointWrapper(const path &dir, const path &fn)
+{
+    auto suffix = getEntryPointSuffix(fn);
+    auto ns = "sw_config" + suffix;
+
+    primitives::Emitter ctx;
+    ctx.addLine("// generated file, do not edit");
+    ctx.addLine();
+    ctx.addLine("namespace " + ns);
+    ctx.addLine("{");
+    ctx.addLine();
+    ctx.addLine("// check() and configure() are optional, config definitions are preferred over these templates");
+    ctx.addLine("template <class T = void>");
+    ctx.addLine("void check(Checker &, T * = nullptr) {}");
+    ctx.addLine("template <class T = void>");
+    ctx.addLine("void configure(Build &, T * = nullptr) {}");
+    ctx.addLine();
+    ctx.addLine("#include \"" + to_string(normalize_path(fn)) + "\"");
+    ctx.addLine();
+    ctx.addLine("}");
+    ctx.addLine();
+    ctx.addLine("SW_PACKAGE_API void build" + suffix + "(Solution &s) { " + ns + "::build(s); }");
+    ctx.addLine("SW_PACKAGE_API void check" + suffix + "(Checker &c) { " + ns + "::check(c); }");
+    ctx.addLine("SW_PACKAGE_API void configure" + suffix + "(Build &b) { " + ns + "::configure(b); }");
+
+    auto w = dir / ("cfg" + suffix + ".cpp");
+    write_file_if_different(w, ctx.getText());
+    return w;
+}
+
+// many input files to one dll
+path PrepareConfig::many2one(Build &b, const std::vector<InputData> &inputs)
+{
+    SW_CHECK(!inputs.empty());
+
+    // dll is shared only by the same set of configs built with the same settings,
+    // so other projects or groups do not relink (or overwrite loaded) dll
+    std::set<String> members;
+    for (auto &d : inputs)
+        members.insert(to_string(normalize_path(d.cfn)));
+    auto h = b.module_data.current_settings.getHash();
+    for (auto &m : members)
+        h += "\n" + m;
+    auto gh = shorten_hash(blake2b_512(h), 8);
+    auto dir = b.getContext().getLocalStorage().storage_dir_tmp / "cfg" / "many2one" / gh;
+
+    UnresolvedPackages udeps;
+    std::vector<InputData> wrappers;
+    for (auto &d : inputs)
+    {
+        auto [_, udeps2] = getFileDependencies(b.getContext(), d.cfn);
+        udeps.insert(udeps2.begin(), udeps2.end());
+
+        auto w = d;
+        w.fn = w.cfn = writeEntryPointWrapper(dir, d.cfn);
+        wrappers.push_back(w);
+    }
+
+    PackagePath name = "loc.sw.self.many2one." + gh;
+    auto &lib = commonActions(b, wrappers[0], udeps, name);
+    for (auto &w : wrappers)
+    {
+        if (&w != &wrappers[0])
+            lib += w.fn;
+
+        FilesOrdered fi_files;
+        fi_files.push_back(driver_idir / getSw1Header());
+        // abi function must be defined only once per dll
+        if (&w == &wrappers[0])
+            fi_files.push_back(driver_idir / getSwCheckAbiVersionHeader());
+        addForcedIncludes(lib, w.fn, fi_files);
+
+        if (auto nsf = lib[w.fn].as<NativeSourceFile *>())
+            nsf->setOutputFile(dir / "obj" / w.fn.stem() += nsf->getCompiler().getObjectExtension(lib.getBuildSettings().TargetOS));
+    }
+
+    // sort deps first!
+    for (auto &d : std::set<UnresolvedPackage>(udeps.begin(), udeps.end()))
+        lib += std::make_shared<Dependency>(d);
+
+    commonActions2(b, lib);
+
+    auto dll = lib.getOutputFile();
+    for (auto &d : inputs)
+    {
+        r[d.fn].dll = dll;
+        r[d.fn].entry_point_suffix = getEntryPointSuffix(d.cfn);
+    }
+    return dll;
+}
+
+path getConfigFilesList(const path &dll)
+{
+    return path(dll) += ".files";
+}
+
+void PrepareConfig::saveConfigFiles() const
+{
+    for (auto &t : targets)
+    {
+        auto fn = getConfigFilesList(t->getOutputFile());
+        // implicit inputs are known only for executed commands, so keep old ones
+        FilesSorted files;
+        if (fs::exists(fn))
+        {
+            for (auto &f : read_lines(fn))
+                files.insert(fs::u8path(f));
+        }
+        Files outputs;
+        for (auto &c : t->getCommands())
+            outputs.insert(c->outputs.begin(), c->outputs.end());
+        for (auto &c : t->getCommands())
+        {
+            for (auto &f : c->inputs)
+                files.insert(f);
+            for (auto &f : c->implicit_inputs)
+                files.insert(f);
+        }
+        String s;
+        for (auto &f : files)
+        {
+            if (!outputs.contains(f))
+                s += to_string(normalize_path(f)) + "\n";
+        }
+        write_file_if_different(fn, s);
+    }
+}
+
 bool PrepareConfig::isOutdated() const
 {
     if (inputs_outdated)
@@ -62,12 +62,15 @@ struct PrepareConfigOutputData
 {
     path dll;
     FilesOrdered PATH;
+    // non empty when several configs are linked into one dll
+    String entry_point_suffix;
 
     template <class Ar>
     void serialize(Ar & ar, unsigned)
     {
         ar & dll;
         ar & PATH;
+        ar & entry_point_suffix;
     }
 };
 
@@ -84,29 +87,42 @@ struct PrepareConfig
 
     FilesMap r;
     std::optional<PackageId> tgt;
-    enum
-    {
+    enum
+    {
         LANG_CPP,
         LANG_C,
-        LANG_VALA
+        LANG_VALA
     } lang;
     std::set<SharedLibraryTarget *> targets;
+    // link storage configs into shared dlls by groups
+    bool many2one = false;
 
     // output var
     //mutable UnresolvedPackages udeps;
 
     void addInput(Build &, const Input &);
+    void addInputs(Build &, const std::set<Input *> &);
     bool isOutdated() const;
+    /// after build, stores files every config was built from
+    void saveConfigFiles() const;
 
 private:
     bool inputs_outdated = false;
     path driver_idir;
 
-    SharedLibraryTarget &createTarget(Build &, const InputData &);
-    decltype(auto) commonActions(Build &, const InputData &, const UnresolvedPackages &deps);
+    InputData getInputData(const Input &);
+    void setInputOutdated(const Input &, const path &dll);
+    SharedLibraryTarget &createTarget(Build &, const InputData &, const PackagePath &name);
+    decltype(auto) commonActions(Build &, const InputData &, const UnresolvedPackages &deps, const PackagePath &name = {});
+    void commonActions2(Build &, SharedLibraryTarget &);
 
     // one input file to one dll
     path one2one(Build &, const InputData &);
+    // many input files to one dll, every input gets its own entry points
+    path many2one(Build &, const std::vector<InputData> &);
 };
 
+/// list of files config dll was built from (sources, included headers)
+path getConfigFilesList(const path &dll);
+
 }
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#include "cache.h"
+
+#include <sw/core/sw_context.h>
+#include <sw/manager/storage.h>
+
+#include <cmsys/Glob.hxx>
+#include <primitives/hash.h>
+
+#include <algorithm>
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "fe.cache");
+
+// bump when stored results change their format
+#define FRONTEND_CACHE_VERSION 3
+
+namespace sw::driver::cpp::frontend
+{
+
+Strings GlobProbe::run() const
+{
+    // same setup as cmake file(GLOB) does
+    cmsys::Glob g;
+    g.SetRecurse(recurse);
+    g.SetRecurseThroughSymlinks(follow_symlinks);
+    g.SetListDirs(list_dirs);
+    g.SetRecurseListDirs(recurse_list_dirs);
+    if (!relative.empty())
+        g.SetRelative(relative.c_str());
+    if (!g.FindFiles(expression))
+        return {};
+    Strings files = g.GetFiles();
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+FrontendCache::FrontendCache(const path &dir)
+    : dir(dir)
+{
+}
+
+path FrontendCache::getEntryPath(const String &key) const
+{
+    return dir / (shorten_hash(blake2b_512(key), 32) + ".json");
+}
+
+nlohmann::json FrontendCache::load(const String &key) const
+{
+    auto fn = getEntryPath(key);
+    if (!fs::exists(fn))
+        return {};
+    try
+    {
+        auto j = nlohmann::json::parse(read_file(fn));
+        if (j["version"] != FRONTEND_CACHE_VERSION || j["key"] != key)
+            return {};
+        // outputs may be shared with other settings (configure_file() into the same dir),
+        // so they must be exactly ours
+        for (auto &[f, h] : j["outputs"].items())
+        {
+            path p = fs::u8path(f);
+            if (!fs::exists(p) || strong_file_hash_file(p) != h.get<String>())
+            {
+                LOG_TRACE(logger, "Frontend cache entry is outdated, output changed: " << f);
+                return {};
+            }
+        }
+        for (auto &[f, h] : j["files"].items())
+        {
+            path p = fs::u8path(f);
+            if (!fs::exists(p) || strong_file_hash_file(p) != h.get<String>())
+            {
+                LOG_TRACE(logger, "Frontend cache entry is outdated, file changed: " << f);
+                return {};
+            }
+        }
+        for (auto &g : j["globs"])
+        {
+            GlobProbe p;
+            p.expression = g["expression"].get<String>();
+            p.recurse = g["recurse"].get<bool>();
+            p.list_dirs = g["list_dirs"].get<bool>();
+            p.recurse_list_dirs = g["recurse_list_dirs"].get<bool>();
+            p.follow_symlinks = g["follow_symlinks"].get<bool>();
+            p.relative = g["relative"].get<String>();
+            if (p.run() != g["files"].get<Strings>())
+            {
+                LOG_TRACE(logger, "Frontend cache entry is outdated, glob changed: " << p.expression);
+                return {};
+            }
+        }
+        for (auto &[f, e] : j["exists"].items())
+        {
+            if (fs::exists(fs::u8path(f)) != e.get<bool>())
+            {
+                LOG_TRACE(logger, "Frontend cache entry is outdated, existence changed: " << f);
+                return {};
+            }
+        }
+        return j["result"];
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Bad frontend cache entry " << normalize_path(fn) << ": " << e.what());
+    }
+    return {};
+}
+
+void FrontendCache::save(const String &key, const Files &files, const Files &outputs, const nlohmann::json &result, const Probes &probes) const
+{
+    nlohmann::json j;
+    j["version"] = FRONTEND_CACHE_VERSION;
+    j["key"] = key;
+    j["files"] = nlohmann::json::object();
+    j["outputs"] = nlohmann::json::object();
+    j["globs"] = nlohmann::json::array();
+    j["exists"] = nlohmann::json::object();
+    try
+    {
+        for (auto &f : files)
+            j["files"][to_string(normalize_path(f))] = strong_file_hash_file(f);
+        for (auto &f : outputs)
+            j["outputs"][to_string(normalize_path(f))] = strong_file_hash_file(f);
+        for (auto &p : probes.globs)
+        {
+            nlohmann::json g;
+            g["expression"] = p.expression;
+            g["recurse"] = p.recurse;
+            g["list_dirs"] = p.list_dirs;
+            g["recurse_list_dirs"] = p.recurse_list_dirs;
+            g["follow_symlinks"] = p.follow_symlinks;
+            g["relative"] = p.relative;
+            g["files"] = p.files;
+            j["globs"].push_back(g);
+        }
+        for (auto &[f, e] : probes.exists)
+            j["exists"][f] = e;
+        j["result"] = result;
+
+        // other processes may read the same entry
+        auto fn = getEntryPath(key);
+        fs::create_directories(dir);
+        auto tmp = path(fn) += "." + to_string(unique_path().u8string()) + ".tmp";
+        write_file(tmp, j.dump());
+        fs::rename(tmp, fn);
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Cannot store frontend cache entry: " << e.what());
+    }
+}
+
+FrontendCache &getFrontendCache(const SwContext &swctx)
+{
+    static FrontendCache c(swctx.getLocalStorage().storage_dir_tmp / "fe");
+    return c;
+}
+
+} // namespace sw::driver::cpp::frontend
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#pragma once
+
+#include <sw/support/filesystem.h>
+
+#include <nlohmann/json.hpp>
+
+#include <map>
+#include <vector>
+
+namespace sw
+{
+
+struct SwContext;
+
+namespace driver::cpp::frontend
+{
+
+/// file(GLOB) call, same data as cmGlobVerificationManager keeps
+struct GlobProbe
+{
+    /// absolute
+    String expression;
+    bool recurse = false;
+    bool list_dirs = true;
+    bool recurse_list_dirs = false;
+    bool follow_symlinks = false;
+    String relative;
+    /// sorted result
+    Strings files;
+
+    /// globs again, returns sorted result
+    Strings run() const;
+};
+
+/// Filesystem queries made by the frontend.
+/// Entry is valid while they give the same results.
+struct Probes
+{
+    std::vector<GlobProbe> globs;
+    /// if(EXISTS) results
+    std::map<String, bool> exists;
+};
+
+/// Parse results of non-native frontends stored between runs.
+///
+/// Entry is valid while all files read by the frontend have the same contents
+/// and probes give the same results.
+/// Everything else the result depends on (settings hash, frontend name)
+/// must be a part of the key.
+///
+/// Layout:
+///  <dir>/<key hash>.json - {files: {path: hash}, outputs: {path: hash}, globs, exists, result}
+struct FrontendCache
+{
+    FrontendCache(const path &dir);
+
+    /// returns null when there is no valid entry
+    nlohmann::json load(const String &key) const;
+
+    /// files - all files read by the frontend
+    /// outputs - files written by the frontend, entry is dropped when they are missing or changed
+    void save(const String &key, const Files &files, const Files &outputs, const nlohmann::json &result, const Probes & = {}) const;
+
+private:
+    path dir;
+
+    path getEntryPath(const String &key) const;
+};
+
+FrontendCache &getFrontendCache(const SwContext &);
+
+} // namespace driver::cpp::frontend
+
+} // namespace sw
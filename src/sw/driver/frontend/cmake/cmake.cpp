@@ -4,20 +4,26 @@
 
 #include "cmake_fe.h"
 
+#include "../cache.h"
+
 #include <sw/driver/sw.h>
 
 #include <cmake.h>
 #include <cmExecutionStatus.h>
 #include <cmGlobalGenerator.h>
 #include <cmList.h>
+#include <cmListFileCache.h>
 #include <cmMakefile.h>
 #include <cmSourceFile.h>
 #include <cmState.h>
 #include <cmStringAlgorithms.h>
+#include <cmSystemTools.h>
 #include <cmTargetPropertyComputer.h>
 // commands
 #include <cmIncludeCommand.h>
 
+#include <regex>
+
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "fe.cmake");
 
@@ -125,6 +131,67 @@ DEFINE_STATIC_CMAKE_COMMAND(sw_cmIncludeCommand)
     return true;
 }
 
+// parses file(GLOB) arguments like cmFileCommand does and globs again
+static void add_glob_probes(sw::driver::cpp::frontend::Probes &probes, const Strings &args, const String &cwd)
+{
+    if (args.size() < 2 || (args[0] != "GLOB" && args[0] != "GLOB_RECURSE"))
+        return;
+
+    sw::driver::cpp::frontend::GlobProbe p;
+    p.recurse = args[0] == "GLOB_RECURSE";
+    for (size_t i = 2; i < args.size(); i++)
+    {
+        if (args[i] == "LIST_DIRECTORIES" && i + 1 < args.size())
+        {
+            p.list_dirs = p.recurse_list_dirs = cmIsOn(args[++i]);
+            continue;
+        }
+        if (args[i] == "RELATIVE" && i + 1 < args.size())
+        {
+            p.relative = args[++i];
+            continue;
+        }
+        if (args[i] == "FOLLOW_SYMLINKS")
+        {
+            p.follow_symlinks = p.recurse;
+            continue;
+        }
+        if (args[i] == "CONFIGURE_DEPENDS")
+            continue;
+        p.expression = args[i];
+        if (!cmSystemTools::FileIsFullPath(p.expression))
+            p.expression = cwd + "/" + p.expression;
+        p.files = p.run();
+        probes.globs.push_back(p);
+    }
+}
+
+// records if(EXISTS) results
+static void add_exists_probes(sw::driver::cpp::frontend::Probes &probes, const Strings &args)
+{
+    for (size_t i = 0; i + 1 < args.size(); i++)
+    {
+        if (args[i] == "EXISTS")
+            probes.exists[args[i + 1]] = cmSystemTools::FileExists(args[i + 1]);
+    }
+}
+
+// elseif() and while() conditions are evaluated inside cmake function blockers,
+// so we cannot record them
+static bool has_unrecorded_probes(const Files &list_files)
+{
+    static const std::regex r(R"xxx(\b(elseif|while)\s*\([^)]*\bEXISTS\b)xxx", std::regex::icase);
+    for (auto &f : list_files)
+    {
+        if (std::regex_search(read_file(f), r))
+        {
+            LOG_DEBUG(logger, "Not caching configuration, conditional EXISTS check in " << normalize_path(f));
+            return true;
+        }
+    }
+    return false;
+}
+
 template <class Check, int NArgs = 0>
 DEFINE_STATIC_CMAKE_COMMAND(sw_cm_check)
 {
@@ -245,6 +312,37 @@ void CmakeTargetEntryPoint::init() const
     cm->AddCacheEntry("CMAKE_INSTALL_PREFIX", to_string(normalize_path(bdir / "install")).c_str(), "", cmStateEnums::STRING);
 
     override_command("include", sw_cmIncludeCommand);
+
+    // record filesystem queries, cached configuration is valid while they give the same results
+    probes = {};
+    read_files.clear();
+    auto file_command = cm->GetState()->GetCommand("file");
+    override_command("file", [file_command](std::vector<cmListFileArgument> const &args, cmExecutionStatus &status)
+    {
+        Strings expanded;
+        status.GetMakefile().ExpandArguments(args, expanded);
+        if (!file_command(args, status))
+            return false;
+        auto &cwd = status.GetMakefile().GetCurrentSourceDirectory();
+        add_glob_probes(cmep->probes, expanded, cwd);
+        // file(READ/STRINGS/...) inputs are not list files
+        for (auto &f : getFileCommandInputs(expanded, cwd))
+        {
+            if (fs::exists(f))
+                cmep->read_files.insert(f);
+            else
+                cmep->probes.exists[to_string(normalize_path(f))] = false;
+        }
+        return true;
+    });
+    auto if_command = cm->GetState()->GetCommand("if");
+    override_command("if", [if_command](std::vector<cmListFileArgument> const &args, cmExecutionStatus &status)
+    {
+        Strings expanded;
+        status.GetMakefile().ExpandArguments(args, expanded);
+        add_exists_probes(cmep->probes, expanded);
+        return if_command(args, status);
+    });
     reset_command("find_package");
     reset_command("install");
     //reset_command("cmake_minimum_required");
@@ -280,6 +378,16 @@ std::vector<ITargetPtr> CmakeTargetEntryPoint::loadPackages(SwBuild &mb, const T
     this->b = &mb;
     this->ts = ts;
 
+    // configure results depend only on read files and current settings (checks are performed with them)
+    auto &fc = frontend::getFrontendCache(mb.getContext());
+    auto key = "cmake\n" + to_string(normalize_path(rootfn)) + "\n" + ts.getHash();
+    targets = fc.load(key);
+    if (!targets.is_null())
+    {
+        LOG_DEBUG(logger, "Using cached configuration of " << normalize_path(rootfn));
+        return Base::loadPackages(mb, ts, pkgs, prefix);
+    }
+
     sw::Build b(mb);
     b.module_data.current_settings = ts;
     b.setSourceDirectory(mb.getBuildDirectory());
@@ -296,85 +404,110 @@ std::vector<ITargetPtr> CmakeTargetEntryPoint::loadPackages(SwBuild &mb, const T
     // by default BUILD_SHARED_LIBS is off in cmake, we follow that
     //cm->AddCacheEntry("BUILD_SHARED_LIBS", t->getBuildSettings().Native.LibrariesType == LibraryType::Shared ? "1" : "0", "", cmStateEnums::BOOL);
 
+    Files output_files;
+    targets = describeTargets(read_files, output_files);
+    if (!has_unrecorded_probes(read_files))
+        fc.save(key, read_files, output_files, targets, probes);
+
     return Base::loadPackages(mb, ts, pkgs, prefix);
 }
 
 void CmakeTargetEntryPoint::loadPackages1(Build &b) const
 {
-    //
-    auto &mfs = cm->GetGlobalGenerator()->GetMakefiles();
-
     // gather targets
     StringSet list_of_targets;
-    for (auto &mf : mfs)
+    for (auto &d : targets)
+        list_of_targets.insert(d["name"].get<String>());
+
+    //
+    for (auto &d : targets)
     {
-        auto &ts = mf->GetTargets();
-        for (auto &[n, cmt] : ts)
-        {
-            list_of_targets.insert(n);
-        }
+        auto nt = addTarget(b, d);
+        if (!nt)
+            continue;
+        setupTarget(*nt, d, list_of_targets);
     }
+}
 
-    //
+Files CmakeTargetEntryPoint::getFileCommandInputs(const Strings &args, const path &cwd)
+{
+    static const StringSet modes
+    {
+        "READ", "STRINGS", "TIMESTAMP",
+        "MD5", "SHA1", "SHA224", "SHA256", "SHA384", "SHA512",
+        "SHA3_224", "SHA3_256", "SHA3_384", "SHA3_512",
+    };
+    if (args.size() < 2 || !modes.contains(args[0]))
+        return {};
+    // relative to current source dir like cmake does
+    path p = args[1];
+    if (p.is_relative())
+        p = cwd / p;
+    return { p.lexically_normal() };
+}
+
+nlohmann::json CmakeTargetEntryPoint::describeTargets(Files &read_files, Files &output_files) const
+{
+    auto &mfs = cm->GetGlobalGenerator()->GetMakefiles();
+
+    nlohmann::json j = nlohmann::json::array();
     for (auto &mf : mfs)
     {
+        // list files include configure_file() inputs
+        for (auto &f : mf->GetListFiles())
+            read_files.insert(f);
+        for (auto &f : mf->GetOutputFiles())
+            output_files.insert(f);
+
         auto &ts = mf->GetTargets();
         for (auto &[n, cmt] : ts)
-        {
-            auto nt = addTarget(b, cmt);
-            if (!nt)
-                continue;
-            setupTarget(*mf, cmt, *nt, list_of_targets);
-        }
+            j.push_back(describeTarget(*mf, cmt));
     }
+    return j;
 }
 
-NativeCompiledTarget *CmakeTargetEntryPoint::addTarget(Build &b, cmTarget &cmt)
+nlohmann::json CmakeTargetEntryPoint::describeTarget(cmMakefile &mf, cmTarget &cmt)
 {
+    nlohmann::json j;
+    j["name"] = cmt.GetName();
     switch (cmt.GetType())
     {
     case cmStateEnums::TargetType::EXECUTABLE:
-        return &b.addExecutable(cmt.GetName());
+        j["type"] = "executable";
+        break;
     case cmStateEnums::TargetType::OBJECT_LIBRARY: // consider as static?
     case cmStateEnums::TargetType::STATIC_LIBRARY:
-        return &b.addStaticLibrary(cmt.GetName());
+        j["type"] = "static";
+        break;
     case cmStateEnums::TargetType::MODULE_LIBRARY: // consider as shared
     case cmStateEnums::TargetType::SHARED_LIBRARY:
-        return &b.addSharedLibrary(cmt.GetName());
+        j["type"] = "shared";
+        break;
     case cmStateEnums::TargetType::INTERFACE_LIBRARY: // like header only
-    {
-        auto nt = &b.addLibrary(cmt.GetName());
-        nt->HeaderOnly = true;
-        return nt;
-    }
+        j["type"] = "interface";
+        break;
     case cmStateEnums::TargetType::UTILITY:
-        return nullptr; // skip
+        j["type"] = "utility"; // skip, but keep the name
+        return j;
                         //GLOBAL_TARGET,
                         //UNKNOWN_LIBRARY
     default:
         SW_UNIMPLEMENTED;
     }
-}
 
-void CmakeTargetEntryPoint::setupTarget(cmMakefile &mf, cmTarget &cmt, NativeCompiledTarget &t, const StringSet &list_of_targets) const
-{
+    auto add_list = [&j](const String &key, const String &list)
+    {
+        for (auto &v : cmList{list})
+            j[key].push_back(v);
+    };
+
     // properties
     if (auto prop = cmt.GetProperty("CXX_STANDARD"))
-    {
-        if (*prop == "11")
-            t += cpp11;
-        if (*prop == "14")
-            t += cpp14;
-        if (*prop == "17")
-            t += cpp17;
-        if (*prop == "20")
-            t += cpp20;
-    }
+        j["cxx_standard"] = *prop;
     if (auto prop = cmt.GetProperty("CXX_EXTENSIONS"); prop && cmIsOn(*prop))
-        t.CPPExtensions = true;
-    if (auto prop = cmt.GetProperty("WINDOWS_EXPORT_ALL_SYMBOLS"); prop && cmIsOn(*prop) &&
-        t.getBuildSettings().TargetOS.is(OSType::Windows))
-        t.ExportAllSymbols = true;
+        j["cxx_extensions"] = true;
+    if (auto prop = cmt.GetProperty("WINDOWS_EXPORT_ALL_SYMBOLS"); prop && cmIsOn(*prop))
+        j["export_all_symbols"] = true;
 
     // sources
     if (auto prop = cmTargetPropertyComputer::GetProperty(&cmt, "SOURCES", mf))
@@ -384,7 +517,7 @@ void CmakeTargetEntryPoint::setupTarget(cmMakefile &mf, cmTarget &cmt, NativeCom
             path p = sf;
             if (p.is_absolute())
             {
-                t += p;
+                j["sources"].push_back(sf);
                 continue;
             }
 
@@ -394,46 +527,120 @@ void CmakeTargetEntryPoint::setupTarget(cmMakefile &mf, cmTarget &cmt, NativeCom
                 auto fp = psf->ResolveFullPath();
                 if (!fp.empty())
                 {
-                    t += path(fp);
+                    j["sources"].push_back(fp);
                     continue;
                 }
             }
 
-            t += path(sf);
+            j["sources"].push_back(sf);
         }
     }
 
     // defs
     for (auto &d : mf.GetCompileDefinitionsEntries())
-    {
-        for (auto &def : cmList{d.Value})
-            t += Definition(def);
-    }
+        add_list("definitions", d.Value);
     for (auto &d : cmt.GetCompileDefinitionsEntries())
+        add_list("definitions", d.Value);
+    if (auto prop = cmt.GetProperty("INTERFACE_COMPILE_DEFINITIONS"))
+        add_list("interface_definitions", *prop);
+
+    // idirs
+    for (auto &i : cmt.GetIncludeDirectoriesEntries())
+        add_list("include_directories", i.Value);
+
+    // ldirs
+    for (auto &ld : cmt.GetLinkDirectoriesEntries())
+        add_list("link_directories", ld.Value);
+
+    // libs
+    for (auto &[n, type] : cmt.GetOriginalLinkLibraries())
+        j["link_libraries"].push_back(n);
+    // more libs
+    for (auto &li : cmt.GetLinkImplementationEntries())
+        add_list("link_libraries", li.Value);
+    // public libs
+    if (auto prop = cmt.GetProperty("INTERFACE_LINK_LIBRARIES"))
+        add_list("interface_link_libraries", *prop);
+
+    return j;
+}
+
+NativeCompiledTarget *CmakeTargetEntryPoint::addTarget(Build &b, const nlohmann::json &d)
+{
+    auto name = d["name"].get<String>();
+    auto type = d["type"].get<String>();
+    if (type == "executable")
+        return &b.addExecutable(name);
+    if (type == "static")
+        return &b.addStaticLibrary(name);
+    if (type == "shared")
+        return &b.addSharedLibrary(name);
+    if (type == "interface")
     {
-        for (auto &def : cmList{d.Value})
-            t += Definition(def);
+        auto nt = &b.addLibrary(name);
+        nt->HeaderOnly = true;
+        return nt;
     }
+    return nullptr; // skip
+}
 
-    if (auto prop = cmt.GetProperty("INTERFACE_COMPILE_DEFINITIONS"))
+void CmakeTargetEntryPoint::setupTarget(NativeCompiledTarget &t, const nlohmann::json &d, const StringSet &list_of_targets)
+{
+    auto for_each = [&d](const String &key, auto f)
     {
-        for (auto &def : cmList{*prop})
-            t.Public += Definition(def);
+        if (auto i = d.find(key); i != d.end())
+        {
+            for (auto &v : *i)
+                f(v.get<String>());
+        }
+    };
+
+    // properties
+    if (auto i = d.find("cxx_standard"); i != d.end())
+    {
+        auto prop = i->get<String>();
+        if (prop == "11")
+            t += cpp11;
+        if (prop == "14")
+            t += cpp14;
+        if (prop == "17")
+            t += cpp17;
+        if (prop == "20")
+            t += cpp20;
     }
+    if (d.find("cxx_extensions") != d.end())
+        t.CPPExtensions = true;
+    if (d.find("export_all_symbols") != d.end() &&
+        t.getBuildSettings().TargetOS.is(OSType::Windows))
+        t.ExportAllSymbols = true;
+
+    // sources
+    for_each("sources", [&t](const String &s)
+    {
+        t += path(s);
+    });
+
+    // defs
+    for_each("definitions", [&t](const String &def)
+    {
+        t += Definition(def);
+    });
+    for_each("interface_definitions", [&t](const String &def)
+    {
+        t.Public += Definition(def);
+    });
 
     // idirs
-    for (auto &i : cmt.GetIncludeDirectoriesEntries())
+    for_each("include_directories", [&t](const String &idir)
     {
-        for (auto &idir : cmList{i.Value})
-            t += IncludeDirectory(idir);
-    }
+        t += IncludeDirectory(idir);
+    });
 
     // ldirs
-    for (auto &ld : cmt.GetLinkDirectoriesEntries())
+    for_each("link_directories", [&t](const String &ldir)
     {
-        for (auto &d : cmList{ld.Value})
-            t += LinkDirectory(d);
-    }
+        t += LinkDirectory(ldir);
+    });
 
     // libs
     auto add_link_library_to = [&list_of_targets, &settings = t.getBuildSettings()](auto &t, const String &n)
@@ -480,28 +687,16 @@ void CmakeTargetEntryPoint::setupTarget(cmMakefile &mf, cmTarget &cmt, NativeCom
         }
     };
 
-    for (auto &[n, type] : cmt.GetOriginalLinkLibraries())
+    for_each("link_libraries", [&t, &add_link_library_to](const String &n)
     {
         add_link_library_to(t, n);
-    }
-
-    // more libs
-    for (auto &li : cmt.GetLinkImplementationEntries())
-    {
-        for (auto &n : cmList{li.Value})
-        {
-            add_link_library_to(t, n);
-        }
-    }
+    });
 
     // public libs
-    if (auto prop = cmt.GetProperty("INTERFACE_LINK_LIBRARIES"))
+    for_each("interface_link_libraries", [&t, &add_link_library_to](const String &n)
     {
-        for (auto &n : cmList{*prop})
-        {
-            add_link_library_to(t.Public, n);
-        }
-    }
+        add_link_library_to(t.Public, n);
+    });
 }
 
 }
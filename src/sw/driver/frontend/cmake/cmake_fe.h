@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include "../cache.h"
+
 #include <sw/driver/entry_point.h>
 
+#include <nlohmann/json.hpp>
+
 class cmake;
 class cmTarget;
 class cmMakefile;
@@ -26,6 +30,12 @@ struct CmakeTargetEntryPoint : NativeTargetEntryPoint
     mutable TargetSettings ts;
     mutable NativeCompiledTarget *t = nullptr;
     mutable CheckSet *cs = nullptr;
+    // descriptions of configured targets, they are stored in frontend cache
+    mutable nlohmann::json targets;
+    // file(GLOB) and if(EXISTS) results of the last configure
+    mutable frontend::Probes probes;
+    // files read by file() command, they are not list files
+    mutable Files read_files;
 
     CmakeTargetEntryPoint(const path &fn);
     ~CmakeTargetEntryPoint();
@@ -33,14 +43,19 @@ struct CmakeTargetEntryPoint : NativeTargetEntryPoint
     [[nodiscard]]
     std::vector<ITargetPtr> loadPackages(SwBuild &, const TargetSettings &, const PackageIdSet &pkgs, const PackagePath &prefix) const override;
 
+    /// files read by file(READ), file(STRINGS), file(<HASH>) and file(TIMESTAMP)
+    static Files getFileCommandInputs(const Strings &args, const path &cwd);
+
 private:
     path rootfn;
 
     void init() const;
     void loadPackages1(Build &) const override;
+    nlohmann::json describeTargets(Files &read_files, Files &output_files) const;
 
-    static NativeCompiledTarget *addTarget(Build &, cmTarget &);
-    void setupTarget(cmMakefile &, cmTarget &, NativeCompiledTarget &, const StringSet &list_of_targets) const;
-};
+    static nlohmann::json describeTarget(cmMakefile &, cmTarget &);
+    static NativeCompiledTarget *addTarget(Build &, const nlohmann::json &);
+    static void setupTarget(NativeCompiledTarget &, const nlohmann::json &, const StringSet &list_of_targets);
+};
 
 }
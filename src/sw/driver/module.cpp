@@ -35,21 +35,23 @@ static auto get_function(const Module::DynamicLibrary &dll, const String &fn, bo
     return (F*)nullptr;
 }
 
-Module::Module(std::unique_ptr<Module::DynamicLibrary> dll, bool do_not_remove_bad_module)
-    : module(std::move(dll)), do_not_remove_bad_module(do_not_remove_bad_module)
+Module::Module(const std::shared_ptr<Module::DynamicLibrary> &dll, bool do_not_remove_bad_module, const String &entry_point_suffix)
+    : module(dll), do_not_remove_bad_module(do_not_remove_bad_module)
 {
-#define LOAD(f)                                                                                    \
+#define LOAD_NAME(f, n)                                                                            \
     do                                                                                             \
     {                                                                                              \
-        f##_.name = #f;                                                                            \
+        f##_.name = n;                                                                             \
         f##_.m = this;                                                                             \
         f##_ = get_function<decltype(f##_)::function_type>(*module, f##_.name, f##_.isRequired()); \
     } while (0)
+#define LOAD(f) LOAD_NAME(f, #f + entry_point_suffix)
 
     LOAD(build);
     LOAD(check);
     LOAD(configure);
-    LOAD(sw_get_module_abi_version);
+    // abi function is shared by all configs in module
+    LOAD_NAME(sw_get_module_abi_version, "sw_get_module_abi_version");
 
     // regardless of config version we must check abi
     // example: new abi pushed to SW Network, but user has old client
@@ -82,6 +84,7 @@ Module::Module(std::unique_ptr<Module::DynamicLibrary> dll, bool do_not_remove_b
     }
 
 #undef LOAD
+#undef LOAD_NAME
 }
 
 path Module::getLocation() const
@@ -168,7 +171,7 @@ int Module::sw_get_module_abi_version() const
     return sw_get_module_abi_version_();
 }
 
-std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module)
+std::shared_ptr<Module::DynamicLibrary> loadDynamicLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module)
 {
     if (dll.empty())
         throw SW_RUNTIME_ERROR("Empty module path");
@@ -194,13 +197,13 @@ std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &P
     };
 #endif
 
-    std::unique_ptr<Module::DynamicLibrary> dl;
+    std::shared_ptr<Module::DynamicLibrary> dl;
 
     String err;
     err = "Module " + to_string(normalize_path(dll)) + " is in bad shape";
     try
     {
-        dl = std::make_unique<Module::DynamicLibrary>(dll,
+        dl = std::make_shared<Module::DynamicLibrary>(dll,
             boost::dll::load_mode::rtld_now | boost::dll::load_mode::rtld_global
             //, ec
             );
@@ -230,7 +233,12 @@ std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &P
         throw;
     }
 
-    return std::make_unique<Module>(std::move(dl), do_not_remove_bad_module);
+    return dl;
+}
+
+std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module, const String &entry_point_suffix)
+{
+    return std::make_unique<Module>(loadDynamicLibrary(dll, PATH, do_not_remove_bad_module), do_not_remove_bad_module, entry_point_suffix);
 }
 
 }
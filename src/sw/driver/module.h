@@ -40,7 +40,8 @@ struct SW_DRIVER_CPP_API Module
         bool isRequired() const { return Required; }
     };
 
-    Module(std::unique_ptr<Module::DynamicLibrary>, bool do_not_remove_bad_module);
+    /// entry_point_suffix is used when many configs are linked into one module
+    Module(const std::shared_ptr<Module::DynamicLibrary> &, bool do_not_remove_bad_module, const String &entry_point_suffix = {});
 
     // api
     void build(Build &s) const;
@@ -48,18 +49,19 @@ struct SW_DRIVER_CPP_API Module
     void check(Build &s, Checker &c) const;
     int sw_get_module_abi_version() const;
 
+    path getLocation() const;
+
 private:
-    std::unique_ptr<Module::DynamicLibrary> module;
+    std::shared_ptr<Module::DynamicLibrary> module;
     bool do_not_remove_bad_module;
 
     mutable LibraryCall<void(Build &), true> build_;
     mutable LibraryCall<void(Build &)> configure_;
     mutable LibraryCall<void(Checker &)> check_;
     mutable LibraryCall<int(), true> sw_get_module_abi_version_;
-
-    path getLocation() const;
 };
 
-std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module);
+std::shared_ptr<Module::DynamicLibrary> loadDynamicLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module);
+std::unique_ptr<Module> loadSharedLibrary(const path &dll, const FilesOrdered &PATH, bool do_not_remove_bad_module, const String &entry_point_suffix = {});
 
 }
@@ -352,7 +352,11 @@ void SourceFileStorage::regex_op(const FileRegex &r, Op2 func)
         root_s.resize(root_s.size() - 1);
     auto &files = glob_cache[dir][r.recursive];
     if (files.empty())
+    {
         files = enumerate_files_fast(dir, r.recursive);
+        if (target.isLocal())
+            target.getMainBuild().addGlobbedDirectory(dir, r.recursive);
+    }
 
     bool matches = false;
     for (auto &f : files)
@@ -18,6 +18,7 @@
 #include <sw/support/source.h>
 
 #include <any>
+#include <list>
 #include <mutex>
 #include <optional>
 
@@ -9,8 +9,11 @@
 #include "../build.h"
 #include "../command.h"
 #include "../compiler/detect.h"
+#include "../frontend/cache.h"
 
 #include <sw/builder/jumppad.h>
+#include <sw/builder/module_mapper.h>
+#include <sw/builder/stage.h>
 #include <sw/core/sw_context.h>
 #include <sw/manager/storage.h>
 #include <sw/manager/yaml.h>
@@ -19,6 +22,7 @@
 #include <nlohmann/json.hpp>
 #include <primitives/constants.h>
 #include <primitives/emitter.h>
+#include <primitives/hash.h>
 #include <primitives/debug.h>
 #include <primitives/lock.h>
 #include <pystring.h>
@@ -57,6 +61,26 @@ static int copy_file(path in, path out)
 }
 SW_DEFINE_VISIBLE_FUNCTION_JUMPPAD(sw_copy_file, copy_file)
 
+// pairs of (from, to)
+static int stage_files(Strings files)
+{
+    int r = 0;
+    for (size_t i = 0; i + 1 < files.size(); i += 2)
+    {
+        try
+        {
+            stage_file(files[i], files[i + 1]);
+        }
+        catch (std::exception &)
+        {
+            // file may be in use, as with copy_file above
+            r = 1;
+        }
+    }
+    return r;
+}
+SW_DEFINE_VISIBLE_FUNCTION_JUMPPAD(sw_stage_files, stage_files)
+
 static int remove_file(path f)
 {
     std::error_code ec;
@@ -1221,6 +1245,9 @@ Files NativeCompiledTarget::gatherObjectFilesWithoutLibraries() const
         if (f.extension() == getBuildSettings().TargetOS.getObjectFileExtension())
             obj.insert(f);
     }
+    // msvc wants object of the pch we use
+    if (pch.external && (getCompilerType() == CompilerType::MSVC || getCompilerType() == CompilerType::ClangCl))
+        obj.insert(pch.obj);
     return obj;
 }
 
@@ -1349,53 +1376,43 @@ NativeLinker *NativeCompiledTarget::getSelectedTool() const
     throw SW_RUNTIME_ERROR("No tool selected");
 }
 
-void NativeCompiledTarget::createPrecompiledHeader()
+static String get_pch_header_text(const FilesOrdered &files)
 {
-    // disabled with PP
-    if (PreprocessStep)
-        return;
-
-    auto files = gatherPrecompiledHeaders();
-    if (files.empty())
-        return;
-
-    if (pch.name.empty())
-        pch.name = "sw_pch";
-
-    if (pch.dir.empty())
-        pch.dir = BinaryDir.parent_path() / "pch";
-
-    if (pch.files.empty())
-        pch.files = files;
-
     String h;
-    for (auto &f : pch.files)
+    for (auto &f : files)
     {
         if (f.string()[0] == '<' || f.string()[0] == '\"')
             h += "#include " + f.string() + "\n";
         else
             h += "#include \"" + to_string(normalize_path(f)) + "\"\n";
     }
+    return h;
+}
+
+static void write_pch_files(detail::PrecompiledHeader &pch, FileStorage &s)
+{
     pch.header = pch.get_base_pch_path() += ".h";
     {
         ScopedFileLock lk(pch.header);
-        write_file_if_different(pch.header, h);
+        write_file_if_different(pch.header, get_pch_header_text(pch.files));
     }
-    File(pch.header, getFs()).setGenerated(true); // prevents resolving issues
+    File(pch.header, s).setGenerated(true); // prevents resolving issues
 
     pch.source = pch.get_base_pch_path() += ".cpp"; // msvc
     {
         ScopedFileLock lk(pch.source);
         write_file_if_different(pch.source, "#include \"" + to_string(normalize_path(pch.header)) + "\"");
     }
-    File(pch.source, getFs()).setGenerated(true); // prevents resolving issues
+    File(pch.source, s).setGenerated(true); // prevents resolving issues
+}
 
-    //
+static void set_pch_outputs(detail::PrecompiledHeader &pch, CompilerType ct)
+{
     if (pch.pch.empty())
     {
-        if (getCompilerType() == CompilerType::MSVC || getCompilerType() == CompilerType::ClangCl)
+        if (ct == CompilerType::MSVC || ct == CompilerType::ClangCl)
             pch.pch = pch.get_base_pch_path() += ".pch";
-        else if (isClangFamily(getCompilerType()))
+        else if (isClangFamily(ct))
             pch.pch = path(pch.header) += ".pch";
         else // gcc
             pch.pch = path(pch.header) += ".gch";
@@ -1404,6 +1421,67 @@ void NativeCompiledTarget::createPrecompiledHeader()
         pch.obj = pch.get_base_pch_path() += ".obj";
     if (pch.pdb.empty())
         pch.pdb = pch.get_base_pch_path() += ".pdb";
+}
+
+// points pch creating compiler to other files
+static void set_pch_create_files(Program &p, const detail::PrecompiledHeader &pch)
+{
+    auto setup_vc = [&pch](auto &c)
+    {
+        c->setSourceFile(pch.source, pch.obj);
+        c->PrecompiledHeaderFilename() = pch.pch;
+        c->PrecompiledHeader().create = pch.header;
+        c->PDBFilename = pch.pdb;
+    };
+
+    auto setup_gcc_clang = [&pch](auto &c)
+    {
+        c->setSourceFile(pch.header, pch.pch);
+    };
+
+    if (auto c = p.as<VisualStudioCompiler*>())
+    {
+        setup_vc(c);
+    }
+    else if (auto c = p.as<ClangClCompiler*>())
+    {
+        setup_vc(c);
+    }
+    else if (auto c = p.as<ClangCompiler*>())
+    {
+        setup_gcc_clang(c);
+    }
+    else if (auto c = p.as<GNUCompiler*>())
+    {
+        setup_gcc_clang(c);
+    }
+}
+
+void NativeCompiledTarget::createPrecompiledHeader()
+{
+    // disabled with PP
+    if (PreprocessStep)
+        return;
+
+    auto files = gatherPrecompiledHeaders();
+    if (files.empty())
+        return;
+
+    if (pch.name.empty())
+        pch.name = "sw_pch";
+
+    // placed explicitly
+    if (!pch.dir.empty() || !pch.pch.empty() || !pch.obj.empty() || !pch.pdb.empty())
+        pch.share = false;
+
+    if (pch.dir.empty())
+        pch.dir = BinaryDir.parent_path() / "pch";
+
+    if (pch.files.empty())
+        pch.files = files;
+
+    write_pch_files(pch, getFs());
+    set_pch_outputs(pch, getCompilerType());
 
     //
     getMergeObject() += pch.source;
@@ -1457,11 +1535,97 @@ void NativeCompiledTarget::createPrecompiledHeader()
     }
 }
 
+void NativeCompiledTarget::sharePrecompiledHeader()
+{
+    if (!pch.share || DryRun || already_built)
+        return;
+    auto sf = getMergeObject()[pch.source].as<NativeSourceFile *>();
+    if (!sf)
+        return;
+
+    // files in target dirs may differ between targets
+    Strings local_dirs;
+    for (auto &d : { SourceDir, BinaryDir, BinaryPrivateDir, pch.dir })
+    {
+        if (!d.empty())
+            local_dirs.push_back(to_string(normalize_path(d)));
+    }
+    auto is_local = [&local_dirs](const String &s)
+    {
+        return std::any_of(local_dirs.begin(), local_dirs.end(), [&s](const auto &d) { return s.find(d) != s.npos; });
+    };
+
+    auto root = getMainBuild().getBuildDirectory() / "pch";
+    auto shared_root = to_string(normalize_path(root));
+    auto get_shared_pch = [this, &root](const String &key)
+    {
+        detail::PrecompiledHeader p;
+        p.files = pch.files;
+        p.name = pch.name;
+        p.fancy_name = pch.fancy_name;
+        p.dir = root / key;
+        p.header = p.get_base_pch_path() += ".h";
+        p.source = p.get_base_pch_path() += ".cpp";
+        set_pch_outputs(p, getCompilerType());
+        return p;
+    };
+
+    // prepare copy of the compiler with the same paths for all targets
+    // and take its final flags
+    // every argument goes into the key, so command is the same whoever builds it
+    auto c = sf->compiler->clone();
+    set_pch_create_files(*c, get_shared_pch("key"));
+    auto cmd = c->as<NativeCompiler *>()->getCommand(*this);
+    String k = to_string(normalize_path(cmd->getProgram())) + "\n" + get_pch_header_text(pch.files);
+    for (auto &a : cmd->arguments)
+    {
+        auto s = a->toString();
+        // own include dirs are allowed, targets with the same dirs share pch
+        bool idir = s.size() > 2 && s.find("-I") == 0;
+        if (s.find(shared_root) != s.npos || !is_local(s) || idir)
+        {
+            k += s + "\n";
+            continue;
+        }
+        LOG_TRACE(logger, getPackage().toString() + ": pch is not shared, target specific flag: " + s);
+        return;
+    }
+    for (auto &f : pch.files)
+    {
+        auto s = f.string();
+        if (s[0] == '<' || s[0] == '\"')
+            continue;
+        if (!f.is_absolute() || is_local(to_string(normalize_path(f))))
+            return;
+    }
+    auto key = shorten_hash(blake2b_512(k), 32);
+
+    // all users set up the same command, owner is chosen after prepare
+    auto shared = get_shared_pch(key);
+    write_pch_files(shared, getFs());
+    set_pch_create_files(*sf->compiler, shared);
+    sf->output = sf->getCompiler().getOutputFile();
+    getMainBuild().registerSharedPrecompiledHeader(key, getSharedPrecompiledHeaderUser());
+    shared.external = true;
+    shared.shared_key = key;
+    shared.own_source = pch.source;
+    pch = shared;
+}
+
+String NativeCompiledTarget::getSharedPrecompiledHeaderUser() const
+{
+    return getPackage().toString() + " " + getSettings().getHash();
+}
+
 void NativeCompiledTarget::addPrecompiledHeader()
 {
     if (pch.dir.empty())
         return;
 
+    // our pch source file keeps its path in merge object
+    auto pch_source = pch.source;
+    sharePrecompiledHeader();
+
     // on this step we setup compilers to USE our created pch
     for (auto &f : gatherSourceFiles())
     {
@@ -1470,7 +1634,7 @@ void NativeCompiledTarget::addPrecompiledHeader()
             continue;
         if (sf->skip_pch)
             continue;
-        if (f->file == pch.source)
+        if (f->file == pch_source)
             continue;
 
         auto setup_use_vc = [this](auto &c)
@@ -1515,8 +1679,14 @@ std::shared_ptr<builder::Command> NativeCompiledTarget::getCommand() const
     return getSelectedTool()->getCommand(*this);
 }
 
+// generated commands may be shared by several targets,
+// their names and dependencies are changed under this lock
+// (targets create their commands in parallel)
+static std::mutex shared_generated_commands_mutex;
+
 Commands NativeCompiledTarget::getGeneratedCommands() const
 {
+    std::unique_lock lk(generated_commands_m);
     if (generated_commands)
         return generated_commands.value();
     generated_commands.emplace();
@@ -1548,6 +1718,7 @@ Commands NativeCompiledTarget::getGeneratedCommands() const
     }
 
     // respect ordering
+    std::unique_lock lk2(shared_generated_commands_mutex);
     for (auto i = order.rbegin(); i != order.rend(); i++)
     {
         auto &cmds = i->second;
@@ -1555,6 +1726,7 @@ Commands NativeCompiledTarget::getGeneratedCommands() const
             c->dependencies.insert(cmds.begin(), cmds.end());
         generated.insert(cmds.begin(), cmds.end());
     }
+    lk2.unlock();
 
     generated_commands = generated;
     return generated;
@@ -1623,8 +1795,13 @@ Commands NativeCompiledTarget::getCommands1() const
             cmds.insert(c);
         };
 
+        // shared pch is built by its owner only
+        bool pch_owner = pch.shared_key.empty()
+            || getMainBuild().getSharedPrecompiledHeaderOwner(pch.shared_key) == getSharedPrecompiledHeaderUser();
         for (auto &f : gatherSourceFiles())
         {
+            if (!pch_owner && f->file == pch.own_source)
+                continue;
             auto c = f->getCommand(*this);
             prepare_command(f, c);
         }
@@ -1635,6 +1812,10 @@ Commands NativeCompiledTarget::getCommands1() const
             prepare_command(f, c);
         }
     }
+
+    // link command is ours, heavy part is done before wiring
+    auto link_cmd = getCommand();
+
     for (auto &c : generated)
     {
         String s = "[" + getPackage().toString() + "]" + " generate: ";
@@ -1645,6 +1826,7 @@ Commands NativeCompiledTarget::getCommands1() const
         } else {
             s += std::to_string((uint64_t)this);
         }
+        std::unique_lock lk(shared_generated_commands_mutex);
         c->name = s;
     }
 
@@ -1696,7 +1878,7 @@ Commands NativeCompiledTarget::getCommands1() const
     }*/
 
     // this library, check if nothing to link
-    if (auto c = getCommand())
+    if (auto c = link_cmd)
     {
         c->dependencies.insert(cmds.begin(), cmds.end());
 
@@ -1726,18 +1908,25 @@ Commands NativeCompiledTarget::getCommands1() const
         };
 
         // add dependencies on generated commands from dependent targets
+        Commands deps_generated;
         for (auto &l : get_tgts())
         {
+            // for idir deps generated commands won't be used!
             if (auto nt = l->as<NativeCompiledTarget*>())
             {
-                // for idir deps generated commands won't be used!
                 auto cmds2 = nt->getGeneratedCommands();
-                for (auto &c : cmds)
-                {
-                    if (auto c2 = c->as<driver::Command*>(); c2 && c2->ignore_deps_generated_commands)
-                        continue;
-                    c->dependencies.insert(cmds2.begin(), cmds2.end());
-                }
+                deps_generated.insert(cmds2.begin(), cmds2.end());
+            }
+        }
+        if (!deps_generated.empty())
+        {
+            // our generated commands may be shared
+            std::unique_lock lk(shared_generated_commands_mutex);
+            for (auto &c : cmds)
+            {
+                if (auto c2 = c->as<driver::Command*>(); c2 && c2->ignore_deps_generated_commands)
+                    continue;
+                c->dependencies.insert(deps_generated.begin(), deps_generated.end());
             }
         }
 
@@ -1820,6 +2009,83 @@ bool NativeCompiledTarget::createWindowsRpath() const
         ;
 }
 
+static nlohmann::json bazel_file_to_json(const bazel::File &f)
+{
+    auto parameter_to_json = [](const bazel::Parameter &p)
+    {
+        nlohmann::json j;
+        j["name"] = p.name;
+        j["values"] = p.values;
+        return j;
+    };
+
+    nlohmann::json j;
+    j["functions"] = nlohmann::json::array();
+    for (auto &fn : f.functions)
+    {
+        nlohmann::json jf;
+        jf["name"] = fn.name;
+        jf["parameters"] = nlohmann::json::array();
+        for (auto &p : fn.parameters)
+            jf["parameters"].push_back(parameter_to_json(p));
+        j["functions"].push_back(jf);
+    }
+    j["parameters"] = nlohmann::json::object();
+    for (auto &[n, p] : f.parameters)
+        j["parameters"][n] = parameter_to_json(p);
+    return j;
+}
+
+static bazel::File bazel_file_from_json(const nlohmann::json &j)
+{
+    auto parameter_from_json = [](const nlohmann::json &j)
+    {
+        bazel::Parameter p;
+        p.name = j["name"].get<String>();
+        p.values = j["values"].get<bazel::Values>();
+        return p;
+    };
+
+    bazel::File f;
+    for (auto &jf : j["functions"])
+    {
+        bazel::Function fn;
+        fn.name = jf["name"].get<String>();
+        for (auto &p : jf["parameters"])
+            fn.parameters.push_back(parameter_from_json(p));
+        f.functions.push_back(fn);
+    }
+    for (auto &[n, p] : j["parameters"].items())
+        f.parameters[n] = parameter_from_json(p);
+    return f;
+}
+
+// same BUILD file is used by many targets in every config
+static const bazel::File &parse_bazel_file(const SwContext &swctx, const path &fn)
+{
+    static std::mutex m;
+    static std::unordered_map<String, std::unique_ptr<bazel::File>> files;
+
+    auto s = read_file(fn);
+    auto h = blake2b_512(s);
+    std::unique_lock lk(m);
+    auto &f = files[h];
+    if (f)
+        return *f;
+
+    // parse result does not depend on settings, so contents hash is enough
+    auto &fc = driver::cpp::frontend::getFrontendCache(swctx);
+    auto key = "bazel\n" + h;
+    if (auto j = fc.load(key); !j.is_null())
+        f = std::make_unique<bazel::File>(bazel_file_from_json(j));
+    else
+    {
+        f = std::make_unique<bazel::File>(bazel::parse(s));
+        fc.save(key, {}, {}, bazel_file_to_json(*f));
+    }
+    return *f;
+}
+
 void NativeCompiledTarget::findSources()
 {
     if (ImportFromBazel)
@@ -1837,22 +2103,7 @@ void NativeCompiledTarget::findSources()
         if (bfn.empty())
             throw SW_RUNTIME_ERROR("No bazel file found in SourceDir: " + to_string(normalize_path(SourceDir)));
 
-        auto b = read_file(bfn);
-        auto f = bazel::parse(b);
-
-        /*static std::mutex m;
-        static std::unordered_map<String, bazel::File> files;
-        auto h = sha1(b);
-        auto i = files.find(h);
-        bazel::File *f = nullptr;
-        if (i == files.end())
-        {
-            std::unique_lock lk(m);
-            files[h] = bazel::parse(b);
-            f = &files[h];
-        }
-        else
-            f = &i->second;*/
+        auto &f = parse_bazel_file(getContext(), bfn);
 
         String project_name;
         if (!getPackage().getPath().empty())
@@ -2174,14 +2425,29 @@ const TargetSettings &NativeCompiledTarget::getInterfaceSettings(std::unordered_
     // Do not export any private information.
     // It MUST be extracted from getCommands() call.
 
-    auto &s = interface_settings;
-    // info may change during prepare, so we create it every time for now
-    // TODO: deny calls during prepare()
-    if (interface_settings_set)
-        return s;
+    // info may change only during prepare passes of this target and its header only deps,
+    // so we cache it by their passes
+    // pass 1 is not cached, user code may still change properties
+    const int pass = prepare_pass;
+    bool final = true;
+    std::unordered_set<const void *> visited;
+    const auto stamp = getInterfaceSettingsStamp(final, visited);
+    {
+        std::unique_lock lk(interface_settings_m);
+        if (interface_settings_set)
+            return interface_settings;
+        if (pass > 1)
+        {
+            for (auto &v : interface_settings_versions)
+            {
+                if (v.pass == pass && v.stamp == stamp)
+                    return v.settings;
+            }
+        }
+    }
 
     bool prepared = prepare_pass_done;
-    s = {};
+    TargetSettings s;
 
     s["source_dir"].setPathValue(getContext().getLocalStorage(), SourceDirBase);
     s["binary_dir"].setPathValue(getContext().getLocalStorage(), BinaryDir);
@@ -2375,10 +2641,47 @@ const TargetSettings &NativeCompiledTarget::getInterfaceSettings(std::unordered_
         });
     }
 
-    if (prepared)
+    std::unique_lock lk(interface_settings_m);
+    if (interface_settings_set)
+        return interface_settings;
+    if (prepared && final)
+    {
+        interface_settings = std::move(s);
         interface_settings_set = true;
+        return interface_settings;
+    }
+    std::erase_if(interface_settings_versions, [pass](const auto &v) { return v.pass < pass - 1; });
+    // same settings are stored once per pass
+    for (auto &v : interface_settings_versions)
+    {
+        if (v.pass == pass && v.settings == s)
+        {
+            v.stamp = stamp;
+            return v.settings;
+        }
+    }
+    interface_settings_versions.push_front({ pass, stamp, std::move(s) });
+    return interface_settings_versions.front().settings;
+}
 
-    return s;
+size_t NativeCompiledTarget::getInterfaceSettingsStamp(bool &final, std::unordered_set<const void *> &visited) const
+{
+    size_t h = 0;
+    hash_combine(h, prepare_pass);
+    hash_combine(h, prepare_pass_done);
+    final &= prepare_pass_done;
+    // deps are printed only after prepare
+    if (!visited.insert(this).second || !prepare_pass_done || !active_deps)
+        return h;
+    for (auto &d : getActiveDependencies())
+    {
+        if (d.dep->IncludeDirectoriesOnly || d.dep->LinkLibrariesOnly)
+            continue;
+        auto t = d.dep->getTarget().as<const NativeCompiledTarget *>();
+        if (t && !t->DryRun && *t->HeaderOnly)
+            hash_combine(h, t->getInterfaceSettingsStamp(final, visited));
+    }
+    return h;
 }
 
 bool NativeCompiledTarget::prepare()
@@ -3743,7 +4046,8 @@ void NativeCompiledTarget::prepare_pass5()
                     auto cmd2 = pp_command2.getCommand(*this);
                     cmd2->addOutput(p);
                     cmd2->arguments.push_back("-fmodules-ts");
-                    cmd2->arguments.push_back("-fmodule-mapper=:::" + std::to_string(get_module_mapper_port() + 1) + "?" + f->file.string() + ":" + p.string());
+                    // mapper location is process specific, so it does not affect output
+                    cmd2->push_back(get_module_mapper_argument(ModuleMapperChannel::Scan, f->file.string() + ":" + p.string())).affects_output = false;
                     cmd2->name = "[" + getPackage().toString() + "]/[analyze_modules]/" + f->file.filename().string();
                     registerCommand(*cmd2);
                     gnu_analyze_commands.insert(cmd2);
@@ -3754,7 +4058,7 @@ void NativeCompiledTarget::prepare_pass5()
                         auto p = path{out} += ".ifc.json";
                         c->getCommand(*this)->msvc_modules_file = p;
                         c->getCommand(*this)->arguments.push_back("-fmodules-ts");
-                        c->getCommand(*this)->arguments.push_back("-fmodule-mapper=:::" + std::to_string(get_module_mapper_port() + 0) + "?" + f->file.string() + ":" + p.string());
+                        c->getCommand(*this)->push_back(get_module_mapper_argument(ModuleMapperChannel::Compile, f->file.string() + ":" + p.string())).affects_output = false;
                     }
                 }
                 else
@@ -3764,7 +4068,7 @@ void NativeCompiledTarget::prepare_pass5()
                     auto cmd2 = c->getCommand(*this);
                     cmd2->addOutput(c->OutputFile().parent_path() / "gcm.cache" / ("." + c->InputFile().string() + ".gcm"));
                     cmd2->arguments.push_back("-fmodules-ts");
-                    //cmd2->arguments.push_back("-fmodule-mapper=:::" + std::to_string(get_module_mapper_port() + 1) + "?" + f->file.string() + ":" + p.string());
+                    // header units are built without module mapper
                     cmd2->name = f->fancy_name = c->getCommand(*this)->name = "[" + getPackage().toString() + "]/[header_unit]/" + f->file.filename().string();
                 }
             }
@@ -4786,6 +5090,7 @@ void NativeCompiledTarget::configureFile1(const path &from, const path &to, Conf
     };
 
     configure_files.insert(from);
+    getMainBuild().addFastPathDependency(from);
 
     auto s = read_file(from);
 
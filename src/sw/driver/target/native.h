@@ -176,6 +176,7 @@ private:
     bool already_built = false;
     std::map<path, path> break_gch_deps;
     mutable std::optional<Commands> generated_commands;
+    mutable std::mutex generated_commands_m;
     path outputfile;
     Commands cmds;
     Files configure_files; // needed by IDEs, move to base target later
@@ -204,10 +205,25 @@ private:
     void addFileSilently(const path &);
 
     mutable bool interface_settings_set = false;
+    // settings computed during prepare
+    // callers may hold references during a pass, so versions of current and previous pass are kept
+    struct InterfaceSettingsVersion
+    {
+        int pass;
+        size_t stamp; // see getInterfaceSettingsStamp()
+        TargetSettings settings;
+    };
+    mutable std::list<InterfaceSettingsVersion> interface_settings_versions;
+    mutable std::mutex interface_settings_m;
     const TargetSettings &getInterfaceSettings(std::unordered_set<void*> *visited_targets = nullptr) const override;
+    // changes when this target or embedded header only deps advance their passes
+    // final - all of them are prepared
+    size_t getInterfaceSettingsStamp(bool &final, std::unordered_set<const void *> &visited) const;
 
     FilesOrdered gatherPrecompiledHeaders() const;
     void createPrecompiledHeader();
+    void sharePrecompiledHeader();
+    String getSharedPrecompiledHeaderUser() const;
     void addPrecompiledHeader();
 
     bool libstdcppset = false;
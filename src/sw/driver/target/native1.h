@@ -29,6 +29,11 @@ struct PrecompiledHeader
     path obj; // obj file (msvc)
     path pdb; // pdb file (msvc)
     path pch; // file itself
+    //
+    bool share = true; // build once for all targets with the same headers and flags
+    bool external = false; // may be built by other target
+    String shared_key; // set when shared, owner is known after prepare
+    path own_source; // our pch source file in merge object when shared
 
     path get_base_pch_path() const
     {
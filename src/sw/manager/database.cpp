@@ -201,6 +201,13 @@ void Database::setIntValue(const String &key, int v)
 PackagesDatabase::PackagesDatabase(const path &db_fn)
     : Database(db_fn, packages_db_schema)
 {
+    // existing databases are indexed once, then on updates
+    static const auto search_index_var = "search_index";
+    if (!getIntValue(search_index_var))
+    {
+        updateSearchIndex();
+        setIntValue(search_index_var, 1);
+    }
 }
 
 PackagesDatabase::~PackagesDatabase() = default;
@@ -409,6 +416,7 @@ void PackagesDatabase::installPackage(const PackageId &p, const PackageData &d)
             q = (*db)(select(pkgs.packageId).from(pkgs).where(
                 pkgs.path == d.ppath.toString()
                 ));
+            addToSearchIndex(q.front().packageId.value(), d.ppath.toString());
         }
 
         // insert deps
@@ -418,6 +426,8 @@ void PackagesDatabase::installPackage(const PackageId &p, const PackageData &d)
             pkg_deps.versionRange = d.range.toString()
         ));
     }
+
+    addToSearchIndex(package_id, p.getPath().toString());
 }
 
 void PackagesDatabase::installPackage(const Package &p)
@@ -465,28 +475,185 @@ void PackagesDatabase::deleteOverriddenPackageDir(const path &sdir) const
         );
 }
 
+static String escape_like(const String &s)
+{
+    String r;
+    r.reserve(s.size());
+    for (auto c : s)
+    {
+        if (c == '%' || c == '_' || c == '\\')
+            r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+namespace
+{
+
+struct Statement
+{
+    sqlite3 *db;
+    sqlite3_stmt *stmt = nullptr;
+
+    Statement(sqlite3 *db, const String &q) : db(db)
+    {
+        if (sqlite3_prepare_v2(db, q.c_str(), (int)q.size() + 1, &stmt, 0) != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("cannot prepare query: "s + sqlite3_errmsg(db));
+    }
+    ~Statement() { sqlite3_finalize(stmt); }
+
+    void bind(int i, const String &v)
+    {
+        if (sqlite3_bind_text(stmt, i, v.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("bad bind");
+    }
+
+    void bind(int i, int64_t v)
+    {
+        if (sqlite3_bind_int64(stmt, i, v) != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("bad bind");
+    }
+
+    /// returns true if row is available
+    bool step()
+    {
+        auto rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW)
+            return true;
+        if (rc != SQLITE_DONE)
+            throw SW_RUNTIME_ERROR("sqlite3_step() failed: "s + sqlite3_errmsg(db));
+        return false;
+    }
+
+    void reset()
+    {
+        if (sqlite3_reset(stmt) != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("sqlite3_reset() failed: "s + sqlite3_errmsg(db));
+    }
+
+    int64_t getInt(int i) const { return sqlite3_column_int64(stmt, i); }
+    String getText(int i) const { return (const char *)sqlite3_column_text(stmt, i); }
+};
+
+}
+
+static void index_package(Statement &ins, int64_t id, const String &path)
+{
+    auto insert = [&ins, id](const String &token, int64_t pos)
+    {
+        ins.bind(1, token);
+        ins.bind(2, id);
+        ins.bind(3, pos);
+        ins.step();
+        ins.reset();
+    };
+    insert(path, -1);
+    Strings elements;
+    boost::split(elements, path, boost::is_any_of("."));
+    for (auto &&[i, e] : enumerate(elements))
+        insert(e, elements.size() - 1 - i);
+}
+
+void PackagesDatabase::addToSearchIndex(int64_t package_id, const String &path)
+{
+    auto mdb = db->native_handle();
+    Statement sel(mdb, "SELECT 1 FROM package_search WHERE package_id = ? AND pos = -1;");
+    sel.bind(1, package_id);
+    if (sel.step())
+        return;
+    Statement ins(mdb, "INSERT INTO package_search (token, package_id, pos) VALUES (?, ?, ?);");
+    index_package(ins, package_id, path);
+}
+
+void PackagesDatabase::updateSearchIndex()
+{
+    auto mdb = db->native_handle();
+
+    // works inside and outside of transactions
+    db->execute("SAVEPOINT package_search;");
+    try
+    {
+        // packages that were removed or renamed
+        db->execute(
+            "DELETE FROM package_search WHERE package_id IN ("
+            "SELECT s.package_id FROM package_search s WHERE s.pos = -1 AND NOT EXISTS ("
+            "SELECT 1 FROM package p WHERE p.package_id = s.package_id AND p.path = s.token COLLATE BINARY));");
+
+        // new packages
+        Statement sel(mdb,
+            "SELECT package_id, path FROM package p WHERE NOT EXISTS ("
+            "SELECT 1 FROM package_search s WHERE s.package_id = p.package_id);");
+        Statement ins(mdb, "INSERT INTO package_search (token, package_id, pos) VALUES (?, ?, ?);");
+        while (sel.step())
+            index_package(ins, sel.getInt(0), sel.getText(1));
+    }
+    catch (...)
+    {
+        db->execute("ROLLBACK TO package_search;");
+        db->execute("RELEASE package_search;");
+        throw;
+    }
+    db->execute("RELEASE package_search;");
+}
+
 std::vector<PackagePath> PackagesDatabase::getMatchingPackages(const String &name, int limit, int offset) const
 {
-    String slimit;
-    if (limit > 0)
-        slimit = " LIMIT " + std::to_string(limit);
-    String soffset;
-    if (offset > 0)
-        soffset = " LIMIT " + std::to_string(offset);
+    // sqlite wants limit when offset is present
+    String slimit = " LIMIT ? OFFSET ?";
+    if (limit <= 0)
+        limit = -1;
 
     std::vector<PackagePath> pkgs2;
-    String q;
     if (name.empty())
-        q = "SELECT path FROM package ORDER BY path COLLATE NOCASE" + slimit + soffset;
-    else
-        q = "SELECT path FROM package WHERE path like '%" + name + "%' ORDER BY path COLLATE NOCASE" + slimit + soffset;
-    for (const auto &row : (*db)(
-        custom_query(sqlpp::verbatim(q))
-        .with_result_type_of(select(pkgs.path).from(pkgs))
-        ))
     {
-        pkgs2.push_back(row.path.value());
+        Statement q(db->native_handle(), "SELECT path FROM package ORDER BY path COLLATE NOCASE" + slimit);
+        q.bind(1, limit);
+        q.bind(2, offset);
+        while (q.step())
+            pkgs2.push_back(q.getText(0));
+        return pkgs2;
+    }
+
+    // matches start at path element boundaries: 'boo' finds 'org.sw.demo.boost.asio'
+    // substring matches ('oost') are returned only when there are no such matches
+    // candidates are taken from token index by the first element of the query,
+    // then ranked: exact path, path prefix, package name prefix, others
+    auto first = name.substr(0, name.find('.'));
+    const String boundary_matches =
+        "FROM package_search s JOIN package p ON p.package_id = s.package_id "
+        "WHERE s.token LIKE ?1 ESCAPE '\\' AND s.pos >= 0 AND ('.' || p.path) LIKE ?2 ESCAPE '\\' ";
+
+    // choose the search on all results, not on the current page,
+    // so pages of one query never come from different searches
+    Statement e(db->native_handle(), "SELECT EXISTS (SELECT 1 " + boundary_matches + ")");
+    e.bind(1, escape_like(first) + "%");
+    e.bind(2, "%." + escape_like(name) + "%");
+    if (e.step() && e.getInt(0))
+    {
+        Statement q(db->native_handle(),
+            "SELECT p.path, MIN(CASE WHEN p.path = ?3 THEN 0 WHEN p.path LIKE ?4 ESCAPE '\\' THEN 1 WHEN s.pos = 0 THEN 2 ELSE 3 END) AS r " +
+            boundary_matches +
+            "GROUP BY p.package_id ORDER BY r, p.path COLLATE NOCASE LIMIT ?5 OFFSET ?6");
+        q.bind(1, escape_like(first) + "%");
+        q.bind(2, "%." + escape_like(name) + "%");
+        q.bind(3, name);
+        q.bind(4, escape_like(name) + "%");
+        q.bind(5, limit);
+        q.bind(6, offset);
+        while (q.step())
+            pkgs2.push_back(q.getText(0));
+        return pkgs2;
     }
+
+    // no matches at element boundaries, fall back to substring search (full scan)
+    Statement q2(db->native_handle(),
+        "SELECT path FROM package WHERE path LIKE ?1 ESCAPE '\\' ORDER BY path COLLATE NOCASE LIMIT ?2 OFFSET ?3");
+    q2.bind(1, "%" + escape_like(name) + "%");
+    q2.bind(2, limit);
+    q2.bind(3, offset);
+    while (q2.step())
+        pkgs2.push_back(q2.getText(0));
     return pkgs2;
 }
 
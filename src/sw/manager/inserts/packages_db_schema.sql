@@ -28,6 +28,20 @@ CREATE UNIQUE INDEX ux_package_path ON package (path ASC);
 --
 --------------------------------------------------------------------------------
 
+CREATE TABLE package_search (
+    -- path element, or full path when pos = -1
+    token TEXT NOT NULL COLLATE NOCASE,
+    package_id INTEGER NOT NULL,
+    -- element position from the end, 0 = package name
+    pos INTEGER NOT NULL
+);
+CREATE INDEX ix_package_search_token ON package_search (token);
+CREATE INDEX ix_package_search_package_id ON package_search (package_id);
+
+--------------------------------------------------------------------------------
+--
+--------------------------------------------------------------------------------
+
 CREATE TABLE package_version (
     package_version_id INTEGER PRIMARY KEY,
     package_id INTEGER NOT NULL REFERENCES package ON UPDATE CASCADE ON DELETE CASCADE,
@@ -226,6 +240,21 @@ BEGIN;
 ALTER TABLE package_version_file
 ADD COLUMN source TEXT;
 
+--------------------------------------------------------------------------------
+-- %split
+--------------------------------------------------------------------------------
+
+-- filled by PackagesDatabase::updateSearchIndex()
+CREATE TABLE package_search (
+    -- path element, or full path when pos = -1
+    token TEXT NOT NULL COLLATE NOCASE,
+    package_id INTEGER NOT NULL,
+    -- element position from the end, 0 = package name
+    pos INTEGER NOT NULL
+);
+CREATE INDEX ix_package_search_token ON package_search (token);
+CREATE INDEX ix_package_search_package_id ON package_search (package_id);
+
 --------------------------------------------------------------------------------
 -- % split - merge '%' and 'split' together when patches are available
 --------------------------------------------------------------------------------
@@ -45,7 +45,10 @@ struct SW_MANAGER_API PackagesDatabase : Database
     db::PackageVersionId getPackageVersionId(const PackageId &) const;
     String getPackagePath(db::PackageId) const;
 
+    /// searches by path elements, best matches go first
     std::vector<PackagePath> getMatchingPackages(const String &name = {}, int limit = 0, int offset = 0) const;
+    /// indexes new and renamed packages for getMatchingPackages()
+    void updateSearchIndex();
     VersionSet getVersionsForPackage(const PackagePath &) const;
 
 private:
@@ -55,6 +58,8 @@ private:
     // add type and config later
     // rename to get package version file hash ()
     String getInstalledPackageHash(db::PackageVersionId) const;
+    // indexes one package if it is not indexed yet
+    void addToSearchIndex(int64_t package_id, const String &path);
 };
 
 }
@@ -34,6 +34,24 @@ std::vector<std::shared_ptr<Remote>> get_default_remotes(bool allow_network)
     return rms;
 }
 
+bool is_file_url(const String &url)
+{
+    return url.starts_with("file://");
+}
+
+path file_url_to_path(const String &url)
+{
+    if (!is_file_url(url))
+        throw SW_RUNTIME_ERROR("Not a file url: " + url);
+    auto p = url.substr(7);
+#ifdef _WIN32
+    // file:///C:/dir
+    if (p.size() > 2 && p[0] == '/' && p[2] == ':')
+        p = p.substr(1);
+#endif
+    return p;
+}
+
 String DataSource::getUrl(const Package &pkg) const
 {
     return pkg.formatPath(raw_url);
@@ -86,16 +104,27 @@ Remote::Remote(const String &name, const String &u, bool allow_network)
             url += "/";
     }
 
-    if (!allow_network)
+    // local mirrors do not need network
+    if (!allow_network && !isLocal())
         return;
 
-    String spec_url = url + "static/" SPECIFICATIONS_FILENAME;
-    auto fn = support::get_root_directory() / "remotes" / name / SPECIFICATIONS_FILENAME;
-    if (!fs::exists(fn))
-        download_file(spec_url, fn);
+    path fn;
+    if (isLocal())
+    {
+        // read in place, so mirror updates are visible immediately
+        fn = getLocalDir() / "static" / SPECIFICATIONS_FILENAME;
+    }
+    else
+    {
+        String spec_url = url + "static/" SPECIFICATIONS_FILENAME;
+        fn = support::get_root_directory() / "remotes" / name / SPECIFICATIONS_FILENAME;
+        if (!fs::exists(fn))
+            download_file(spec_url, fn);
+    }
     auto j = nlohmann::json::parse(read_file(fn));
     auto &spec = j["specification"];
-    api_url = spec["api_url"].get<String>();
+    if (spec.contains("api_url"))
+        api_url = spec["api_url"].get<String>();
     auto &jdb = spec["database"];
     if (jdb.contains("url"))
         db.url = jdb["url"].get<String>();
@@ -104,6 +133,17 @@ Remote::Remote(const String &name, const String &u, bool allow_network)
     if (jdb.contains("local_dir"))
         db.local_dir = jdb["local_dir"].get<String>();
     db.version_root_url = jdb["version_root_url"].get<String>();
+    if (isLocal())
+    {
+        // mirror paths are relative to its root, so mirror can be moved
+        auto make_absolute = [this](String &s)
+        {
+            if (!s.empty() && path(s).is_relative())
+                s = to_string(normalize_path(getLocalDir() / s));
+        };
+        make_absolute(db.local_dir);
+        make_absolute(db.version_root_url);
+    }
     if (!db.version_root_url.empty() && db.version_root_url.back() != '/')
         db.version_root_url += "/";
 
@@ -114,6 +154,8 @@ Remote::Remote(const String &name, const String &u, bool allow_network)
         {
             DataSource s;
             s.raw_url = v["url"].get<String>();
+            if (isLocal() && s.raw_url.find("://") == s.raw_url.npos)
+                s.raw_url = url + s.raw_url;
             if (v.contains("flags"))
                 s.flags = v["flags"].get<int64_t>();
             if (s.flags[DataSource::fDisabled])
@@ -125,6 +167,16 @@ Remote::Remote(const String &name, const String &u, bool allow_network)
         throw SW_RUNTIME_ERROR("No data sources available");
 }
 
+bool Remote::isLocal() const
+{
+    return is_file_url(url);
+}
+
+path Remote::getLocalDir() const
+{
+    return file_url_to_path(url);
+}
+
 std::unique_ptr<Api> Remote::getApi() const
 {
     switch (getApiType())
@@ -111,6 +111,10 @@ struct SW_MANAGER_API Remote
 
     bool isDisabled() const { return disabled; }
 
+    /// file:// remote, e.g. mirror created by 'sw mirror'
+    bool isLocal() const;
+    path getLocalDir() const;
+
 private:
     GrpcChannel getGrpcChannel() const;
 
@@ -119,4 +123,10 @@ private:
 
 std::vector<std::shared_ptr<Remote>> get_default_remotes(bool allow_network);
 
+SW_MANAGER_API
+bool is_file_url(const String &url);
+
+SW_MANAGER_API
+path file_url_to_path(const String &url);
+
 }
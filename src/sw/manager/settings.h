@@ -50,6 +50,9 @@ struct SW_MANAGER_API Settings
 
     String save_command_format;
 
+    // output
+    bool status_line = true; // show progress in one line on terminals
+
 public:
     Settings();
     ~Settings();
@@ -18,6 +18,7 @@
 #include <sqlpp11/sqlite3/connection.h>
 
 #include <fstream>
+#include <unordered_set>
 
 #include <primitives/log.h>
 DECLARE_STATIC_LOGGER(logger, "storage");
@@ -32,7 +33,7 @@ namespace sw
 
 RemoteStorage::RemoteStorage(LocalStorage &ls, const Remote &r, bool allow_network)
     : StorageWithPackagesDatabase(r.name, ls.getDatabaseRootDir() / "remote")
-    , r(r), ls(ls), allow_network(allow_network)
+    , r(r), ls(ls), allow_network(allow_network || r.isLocal()) // mirrors are always available
 {
     db_repo_dir = ls.getDatabaseRootDir() / "remote" / r.name / "repository";
 
@@ -160,7 +161,31 @@ static std::istream &safe_getline(std::istream &i, String &s)
     return i;
 }
 
-void RemoteStorage::load() const
+static auto split_csv_line(const String &s)
+{
+    return primitives::csv::parse_line(s, ',', '\"', '\"');
+}
+
+static Strings read_csv(const path &fn, String &header)
+{
+    std::ifstream ifile(fn);
+    if (!ifile)
+        throw SW_RUNTIME_ERROR("Cannot open file " + fn.string() + " for reading");
+
+    // read first line - header
+    safe_getline(ifile, header);
+    Strings lines;
+    String s;
+    while (safe_getline(ifile, s))
+        lines.push_back(s);
+    return lines;
+}
+
+namespace
+{
+
+// inserts or deletes csv rows
+struct CsvTableWriter
 {
     struct Column
     {
@@ -168,19 +193,134 @@ void RemoteStorage::load() const
         bool skip = false;
     };
 
-    static const std::vector<std::pair<String, String>> skip_cols
+    CsvTableWriter(sqlite3 *db, const String &table, const String &header)
+        : db(db)
     {
-        {"package_version", "group_number"},
-        {"package_version", "archive_version"},
-        {"package_version", "hash"},
-    };
-    auto is_skipped_column = [](const String &tablename, const String &name)
+        static const std::vector<std::pair<String, String>> skip_cols
+        {
+            {"package_version", "group_number"},
+            {"package_version", "archive_version"},
+            {"package_version", "hash"},
+        };
+        auto is_skipped_column = [](const String &tablename, const String &name)
+        {
+            return std::find(skip_cols.begin(), skip_cols.end(), std::pair<String, String>{ tablename,name }) != skip_cols.end();
+        };
+
+        // read fields from header
+        for (auto &c : split_csv_line(header))
+        {
+            cols.push_back({ *c });
+            if (is_skipped_column(table, cols.back().name))
+                cols.back().skip = true;
+        }
+
+        // add only them
+        String query = "insert into " + table + " (";
+        String values;
+        String where;
+        for (auto &c : cols)
+        {
+            if (c.skip)
+                continue;
+            query += c.name + ", ";
+            values += "?, ";
+            // 'is' also matches nulls
+            where += c.name + " is ? and ";
+        }
+        query.resize(query.size() - 2);
+        values.resize(values.size() - 2);
+        where.resize(where.size() - 5);
+        query += ") values (" + values + ");";
+        insert_stmt = prepare(query);
+        delete_stmt = prepare("delete from " + table + " where " + where + ";");
+    }
+
+    ~CsvTableWriter()
     {
-        return std::find(skip_cols.begin(), skip_cols.end(), std::pair<String, String>{ tablename,name }) != skip_cols.end();
-    };
+        sqlite3_finalize(insert_stmt);
+        sqlite3_finalize(delete_stmt);
+    }
+
+    void insert(const String &line)
+    {
+        execute(insert_stmt, line);
+    }
+
+    /// returns false if there was no such row
+    bool remove(const String &line)
+    {
+        execute(delete_stmt, line);
+        return sqlite3_changes(db) > 0;
+    }
+
+private:
+    sqlite3 *db;
+    std::vector<Column> cols;
+    sqlite3_stmt *insert_stmt = nullptr;
+    sqlite3_stmt *delete_stmt = nullptr;
+
+    sqlite3_stmt *prepare(const String &query)
+    {
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db, query.c_str(), (int)query.size() + 1, &stmt, 0) != SQLITE_OK)
+            throw SW_RUNTIME_ERROR(sqlite3_errmsg(db));
+        return stmt;
+    }
+
+    void execute(sqlite3_stmt *stmt, const String &line)
+    {
+        int rc;
+        int col = 1;
+        for (const auto &[i,c] : enumerate(split_csv_line(line)))
+        {
+            if (i >= cols.size())
+                throw SW_RUNTIME_ERROR("bad csv line: " + line);
+            if (cols[i].skip)
+                continue;
+            if (c)
+                rc = sqlite3_bind_text(stmt, col, c->c_str(), -1, SQLITE_TRANSIENT);
+            else
+                rc = sqlite3_bind_null(stmt, col);
+            if (rc != SQLITE_OK)
+                throw SW_RUNTIME_ERROR("bad bind");
+            col++;
+        }
+
+        rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE)
+            throw SW_RUNTIME_ERROR("sqlite3_step() failed: "s + sqlite3_errmsg(db));
+        rc = sqlite3_reset(stmt);
+        if (rc != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("sqlite3_reset() failed: "s + sqlite3_errmsg(db));
+    }
+};
+
+}
+
+void RemoteStorage::load() const
+{
+    // apply only changed rows when possible
+    try
+    {
+        load(true);
+        getPackagesDatabase().updateSearchIndex();
+        return;
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Incremental packages database update failed: " << e.what() << ". Reloading.");
+    }
+    load(false);
+    getPackagesDatabase().updateSearchIndex();
+}
+
+void RemoteStorage::load(bool incremental) const
+{
+    // copy of the last applied index, we diff against it
+    auto applied_dir = getPackagesDatabase().fn.parent_path() / "applied";
 
     auto mdb = getPackagesDatabase().db->native_handle();
-    sqlite3_stmt *stmt = nullptr;
 
     // load only known tables
     // alternative: read csv filenames by mask and load all
@@ -193,95 +333,105 @@ void RemoteStorage::load() const
         [](void *o, int, char **cols, char **)
         {
             Strings &data_tables = *(Strings *)o;
-            data_tables.push_back(cols[0]);
+            // local tables
+            if (cols[0] != "package_search"s)
+                data_tables.push_back(cols[0]);
             return 0;
         }, &data_tables, 0);
     sqlite3_close(db2);
     if (rc != SQLITE_OK)
         throw SW_RUNTIME_ERROR("cannot query db for tables: " + to_string(getPackagesDatabase().fn));
 
-    getPackagesDatabase().db->execute("PRAGMA foreign_keys = OFF;");
-    getPackagesDatabase().db->execute("BEGIN;");
-
-    auto split_csv_line = [](const auto &s)
+    auto count_rows = [mdb](const String &table)
     {
-        return primitives::csv::parse_line(s, ',', '\"', '\"');
+        size_t n = 0;
+        auto rc = sqlite3_exec(mdb, ("select count(*) from " + table).c_str(), [](void *o, int, char **cols, char **)
+        {
+            *(size_t *)o = std::stoull(cols[0]);
+            return 0;
+        }, &n, 0);
+        if (rc != SQLITE_OK)
+            throw SW_RUNTIME_ERROR("cannot count rows: "s + sqlite3_errmsg(mdb));
+        return n;
     };
 
-    for (auto &td : data_tables)
-    {
-        getPackagesDatabase().db->execute("delete from " + td);
-
-        auto fn = db_repo_dir / (td + ".csv");
-        std::ifstream ifile(fn);
-        if (!ifile)
-            throw SW_RUNTIME_ERROR("Cannot open file " + fn.string() + " for reading");
-
-        // read first line - header
-        String s;
-        safe_getline(ifile, s);
-        auto csvcols = split_csv_line(s);
+    // everything goes in one transaction,
+    // so readers see old or new index, never a mix
+    getPackagesDatabase().db->execute("PRAGMA foreign_keys = OFF;");
+    getPackagesDatabase().db->execute("BEGIN;");
 
-        // read fields from header
-        std::vector<Column> cols;
-        for (auto &c : csvcols)
+    size_t n_inserted = 0, n_deleted = 0;
+    try
+    {
+        for (auto &td : data_tables)
         {
-            cols.push_back({ *c });
-            if (is_skipped_column(td, cols.back().name))
-                cols.back().skip = true;
-        }
-        auto n_cols = cols.size();
+            String header;
+            auto lines = read_csv(db_repo_dir / (td + ".csv"), header);
 
-        // add only them
-        String query = "insert into " + td + " (";
-        for (auto &c : cols)
-        {
-            if (!c.skip)
-                query += c.name + ", ";
-        }
-        query.resize(query.size() - 2);
-        query += ") values (";
-        for (size_t i = 0; i < n_cols; i++)
-        {
-            if (!cols[i].skip)
-                query += "?, ";
-        }
-        query.resize(query.size() - 2);
-        query += ");";
+            Strings old_lines;
+            bool diff = incremental && fs::exists(applied_dir / (td + ".csv"));
+            if (diff)
+            {
+                String old_header;
+                old_lines = read_csv(applied_dir / (td + ".csv"), old_header);
+                diff = old_header == header;
+            }
 
-        if (sqlite3_prepare_v2(mdb, query.c_str(), (int)query.size() + 1, &stmt, 0) != SQLITE_OK)
-            throw SW_RUNTIME_ERROR(sqlite3_errmsg(mdb));
+            if (diff && old_lines == lines)
+                continue;
 
-        while (safe_getline(ifile, s))
-        {
-            int col = 1;
-            for (const auto &[i,c] : enumerate(split_csv_line(s)))
+            CsvTableWriter w(mdb, td, header);
+            if (!diff)
             {
-                if (cols[i].skip)
+                getPackagesDatabase().db->execute("delete from " + td);
+                for (auto &l : lines)
+                    w.insert(l);
+                n_inserted += lines.size();
+                continue;
+            }
+
+            std::unordered_set<std::string_view> old_set(old_lines.begin(), old_lines.end());
+            std::unordered_set<std::string_view> new_set(lines.begin(), lines.end());
+            for (auto &l : old_lines)
+            {
+                if (new_set.contains(l))
                     continue;
-                if (c)
-                    rc = sqlite3_bind_text(stmt, col, c->c_str(), -1, SQLITE_TRANSIENT);
-                else
-                    rc = sqlite3_bind_null(stmt, col);
-                if (rc != SQLITE_OK)
-                    throw SW_RUNTIME_ERROR("bad bind");
-                col++;
+                if (!w.remove(l))
+                    throw SW_RUNTIME_ERROR("applied index is out of sync with table " + td);
+                n_deleted++;
+            }
+            for (auto &l : lines)
+            {
+                if (old_set.contains(l))
+                    continue;
+                w.insert(l);
+                n_inserted++;
             }
 
-            rc = sqlite3_step(stmt);
-            if (rc != SQLITE_DONE)
-                throw SW_RUNTIME_ERROR("sqlite3_step() failed: "s + sqlite3_errmsg(mdb));
-            rc = sqlite3_reset(stmt);
-            if (rc != SQLITE_OK)
-                throw SW_RUNTIME_ERROR("sqlite3_reset() failed: "s + sqlite3_errmsg(mdb));
+            // validate before commit
+            if (count_rows(td) != lines.size())
+                throw SW_RUNTIME_ERROR("bad number of rows in table " + td + " after update");
         }
-
-        if (sqlite3_finalize(stmt) != SQLITE_OK)
-            throw SW_RUNTIME_ERROR("sqlite3_finalize() failed: "s + sqlite3_errmsg(mdb));
+    }
+    catch (...)
+    {
+        getPackagesDatabase().db->execute("ROLLBACK;");
+        getPackagesDatabase().db->execute("PRAGMA foreign_keys = ON;");
+        throw;
     }
 
     getPackagesDatabase().db->execute("COMMIT;");
     getPackagesDatabase().db->execute("PRAGMA foreign_keys = ON;");
+
+    LOG_DEBUG(logger, "Packages database updated: " << n_inserted << " rows inserted, " << n_deleted << " rows deleted");
+
+    // remember applied index
+    // on failure here, next update will reload bad tables fully
+    error_code ec;
+    fs::remove_all(applied_dir, ec);
+    fs::create_directories(applied_dir);
+    for (auto &td : data_tables)
+        fs::copy_file(db_repo_dir / (td + ".csv"), applied_dir / (td + ".csv"), fs::copy_options::overwrite_existing);
 }
 
 void RemoteStorage::updateDb() const
@@ -290,7 +440,10 @@ void RemoteStorage::updateDb() const
         && !Settings::get_user_settings().gForceServerQuery // for now
         )
     {
-        if (!Settings::get_system_settings().can_update_packages_db || !isCurrentDbOld())
+        if (!Settings::get_system_settings().can_update_packages_db)
+            return;
+        // mirror version file is cheap to check, so we do it every time
+        if (!r.isLocal() && !isCurrentDbOld())
             return;
     }
 
@@ -412,10 +565,31 @@ struct RemoteFileWithHashVerification : vfs::FileWithHashVerification
 
     bool copy(const path &fn, const String &hash) const
     {
+        // index snapshot of a mirror lists all remote packages,
+        // but only the mirrored closure has archives
+        path not_in_mirror;
         auto download_from_source = [&](const auto &url)
         {
             try
             {
+                if (is_file_url(url))
+                {
+                    // local mirror, archive is only read during unpack, so link is enough
+                    LOG_TRACE(logger, "Copying file: " << url);
+                    auto src = file_url_to_path(url);
+                    if (!fs::exists(src))
+                    {
+                        not_in_mirror = src;
+                        return false;
+                    }
+                    error_code ec;
+                    fs::remove(fn, ec);
+                    fs::create_directories(fn.parent_path());
+                    fs::create_hard_link(src, fn, ec);
+                    if (ec)
+                        fs::copy_file(src, fn, fs::copy_options::overwrite_existing);
+                    return true;
+                }
                 LOG_TRACE(logger, "Downloading file: " << url);
                 download_file(url, fn);
             }
@@ -447,6 +621,11 @@ struct RemoteFileWithHashVerification : vfs::FileWithHashVerification
             }
         }
 
+        if (!not_in_mirror.empty())
+        {
+            throw SW_RUNTIME_ERROR("Package " + p.toString() + " is not in mirror (missing " + to_string(normalize_path(not_in_mirror)) +
+                "), add it with 'sw mirror' or use another remote");
+        }
         return false;
     }
 };
@@ -479,14 +658,14 @@ ResolveResult RemoteStorageWithFallbackToRemoteResolving::resolve(const Unresolv
     auto m = RemoteStorage::resolve(pkgs, unresolved_pkgs);
     if (unresolved_pkgs.empty())
         return m;
-    if (!isNetworkAllowed())
+    if (!isNetworkAllowed() || getRemote().isLocal())
         return m;
     if (remote_resolving_is_not_working)
         return m;
 
     // clear dirty output
     unresolved_pkgs.clear();
-
+
     LOG_DEBUG(logger, "Requesting dependency list from " + getRemote().name + " remote...");
 
     try
@@ -27,6 +27,8 @@ struct SW_MANAGER_API RemoteStorage : StorageWithPackagesDatabase
     const Remote &getRemote() const { return r; }
 
     bool isNetworkAllowed() const { return allow_network; }
+    /// downloaded packages index (csv files)
+    const path &getRepositoryDir() const { return db_repo_dir; }
 
 private:
     const Remote &r;
@@ -37,6 +39,7 @@ private:
 
     void download() const;
     void load() const;
+    void load(bool incremental) const;
     void updateDb() const;
     void preInitFindDependencies() const;
     void writeDownloadTime() const;
@@ -17,6 +17,7 @@ namespace sw
 {
 
 SwManagerContext::SwManagerContext(const path &local_storage_root_dir, bool allow_network)
+    : allow_network(allow_network)
 {
     // first goes resolve cache
     cache_storage_id = storages.size();
@@ -24,17 +25,6 @@ SwManagerContext::SwManagerContext(const path &local_storage_root_dir, bool allo
 
     local_storage_id = storages.size();
     storages.emplace_back(std::make_unique<LocalStorage>(local_storage_root_dir));
-
-    first_remote_storage_id = storages.size();
-    for (auto &r : Settings::get_user_settings().getRemotes(allow_network))
-    {
-        if (r->isDisabled())
-            continue;
-        storages.emplace_back(
-            std::make_unique<RemoteStorage>(
-            //std::make_unique<RemoteStorageWithFallbackToRemoteResolving>(
-                getLocalStorage(), *r, allow_network));
-    }
 }
 
 SwManagerContext::~SwManagerContext() = default;
@@ -54,11 +44,30 @@ const LocalStorage &SwManagerContext::getLocalStorage() const
     return static_cast<const LocalStorage&>(*storages[local_storage_id]);
 }
 
+void SwManagerContext::initRemoteStorages() const
+{
+    std::call_once(remotes_flag, [this]
+    {
+        auto &ls = const_cast<LocalStorage &>(getLocalStorage());
+        for (auto &r : Settings::get_user_settings().getRemotes(allow_network))
+        {
+            if (r->isDisabled())
+                continue;
+            remote_storages.emplace_back(
+                std::make_unique<RemoteStorage>(
+                //std::make_unique<RemoteStorageWithFallbackToRemoteResolving>(
+                    ls, *r, allow_network));
+        }
+    });
+}
+
 std::vector<IStorage *> SwManagerContext::getRemoteStorages() const
 {
+    initRemoteStorages();
+
     std::vector<IStorage *> r;
-    for (int i = first_remote_storage_id; i < storages.size(); i++)
-        r.push_back(storages[i].get());
+    for (auto &s : remote_storages)
+        r.push_back(s.get());
     return r;
 }
 
@@ -67,16 +76,32 @@ ResolveResultWithDependencies SwManagerContext::resolve(const UnresolvedPackages
     if (in_pkgs.empty())
         return {};
 
+    // locked and already resolved packages do not need remotes
+    if (use_cache)
+    {
+        UnresolvedPackages unresolved;
+        auto r = resolve(in_pkgs, { &getCachedStorage() }, &unresolved);
+        if (unresolved.empty())
+            return r;
+    }
+
     std::vector<IStorage *> s2;
     for (const auto &[i, s] : enumerate(storages))
     {
         if (i != cache_storage_id || use_cache)
             s2.push_back(s.get());
     }
+    for (auto s : getRemoteStorages())
+        s2.push_back(s);
     return resolve(in_pkgs, s2);
 }
 
 ResolveResultWithDependencies SwManagerContext::resolve(const UnresolvedPackages &in_pkgs, const std::vector<IStorage*> &storages) const
+{
+    return resolve(in_pkgs, storages, nullptr);
+}
+
+ResolveResultWithDependencies SwManagerContext::resolve(const UnresolvedPackages &in_pkgs, const std::vector<IStorage*> &storages, UnresolvedPackages *unresolved_pkgs) const
 {
     std::lock_guard lk(resolve_mutex);
 
@@ -119,7 +144,12 @@ ResolveResultWithDependencies SwManagerContext::resolve(const UnresolvedPackages
                 }
             }
             if (!pkg)
-                throw SW_RUNTIME_ERROR("Package '" + p.toString() + "' is not resolved");
+            {
+                if (!unresolved_pkgs)
+                    throw SW_RUNTIME_ERROR("Package '" + p.toString() + "' is not resolved");
+                unresolved_pkgs->insert(p);
+                continue;
+            }
 
             resolved_step[p] = std::move(pkg);
         }
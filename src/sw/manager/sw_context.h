@@ -54,11 +54,16 @@ struct SW_MANAGER_API SwManagerContext// : ISwContext
 private:
     int cache_storage_id;
     int local_storage_id;
-    int first_remote_storage_id;
     std::vector<std::unique_ptr<IStorage>> storages;
+    // remotes open (and may update) their packages index, so they are created on first use
+    mutable std::vector<std::unique_ptr<IStorage>> remote_storages;
+    mutable std::once_flag remotes_flag;
+    bool allow_network;
     mutable std::mutex resolve_mutex;
 
     CachedStorage &getCachedStorage() const;
+    void initRemoteStorages() const;
+    ResolveResultWithDependencies resolve(const UnresolvedPackages &, const std::vector<IStorage*> &, UnresolvedPackages *unresolved) const;
 };
 
 } // namespace sw
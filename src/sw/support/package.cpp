@@ -30,6 +30,13 @@ static path getHashPathFromHash(const String &h, int nsubdirs, int chars_per_sub
     return p;
 }
 
+path getArchiveHashPath(const String &archive_hash)
+{
+    if (archive_hash.size() < 8)
+        throw SW_RUNTIME_ERROR("Bad archive hash: " + archive_hash);
+    return getHashPathFromHash(archive_hash, 2, 2);
+}
+
 String PackageData::getHash(StorageFileType type, size_t config_hash) const
 {
     if (type == StorageFileType::SourceArchive)
@@ -83,10 +90,15 @@ String Package::formatPath(const String &s) const
     // {PHPF} = package hash path full
     // {PH64} = package hash, length = 64
     // {FN} = archive name
+    // {AHPF} = archive hash path full, same archives of different packages share it
+    String ahpf;
+    if (s.find("{AHPF}") != s.npos)
+        ahpf = to_string(normalize_path(getArchiveHashPath(getData().getHash(StorageFileType::SourceArchive))));
     return fmt::format(fmt::runtime(s),
         fmt::arg("PHPF", to_string(normalize_path(getHashPath()))),
         fmt::arg("PH64", getHash().substr(0, 64)),
-        fmt::arg("FN", support::make_archive_name())
+        fmt::arg("FN", support::make_archive_name()),
+        fmt::arg("AHPF", ahpf)
     );
 }
 
@@ -79,6 +79,10 @@ using ResolveResult = std::unordered_map<UnresolvedPackage, PackagePtr>;
 SW_SUPPORT_API
 String getSourceDirectoryName();
 
+/// content addressed path of source archive (mirrors)
+SW_SUPPORT_API
+path getArchiveHashPath(const String &archive_hash);
+
 }
 
 namespace std
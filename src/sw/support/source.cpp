@@ -3,6 +3,8 @@
 
 #include "source.h"
 
+#include "source_cache.h"
+
 #include <sw/support/filesystem.h>
 
 #include <nlohmann/json.hpp>
@@ -63,7 +65,7 @@ bool download(Executor &e, const std::unordered_set<SourcePtr> &sset, SourceDirM
                 t = d.root_dir;
                 t += ".stamp";
 
-                auto dl = [&src, d, &t, &downloaded]()
+                auto dl = [&src, d, &t, &downloaded, &opts](std::optional<std::chrono::seconds> max_age = {})
                 {
                     downloaded = true;
                     LOG_INFO(logger, "Downloading source:\n" << src->print());
@@ -71,7 +73,8 @@ bool download(Executor &e, const std::unordered_set<SourcePtr> &sset, SourceDirM
                     if (g && !g->tag.empty()) {
                         g->tryVTagPrefixDuringDownload();
                     }
-                    src->download(d.root_dir);
+                    if (!opts.use_cache || !SourceCache::get().download(*src, d.root_dir, max_age))
+                        src->download(d.root_dir);
                     write_file(t, timepoint2string(getUtc()));
                     // save real source
                     nlohmann::json j;
@@ -106,7 +109,8 @@ bool download(Executor &e, const std::unordered_set<SourcePtr> &sset, SourceDirM
                             if (e)
                                 LOG_INFO(logger, "Download data is stale, re-downloading");
                             fs::remove_all(d.root_dir);
-                            dl();
+                            // mutable urls must not come from the cache either
+                            dl(opts.existing_dirs_age);
                         }
                     }
                 }
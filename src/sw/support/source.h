@@ -73,6 +73,7 @@ struct SourceDownloadOptions
     bool ignore_existing_dirs = false;
     std::chrono::seconds existing_dirs_age{ 0 };
     bool adjust_root_dir = true;
+    bool use_cache = true; // global source cache, see SourceCache
 };
 
 // returns true if downloaded
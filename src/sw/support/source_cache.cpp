@@ -0,0 +1,389 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#include "source_cache.h"
+
+#include "filesystem.h"
+
+#include <primitives/command.h>
+#include <primitives/date_time.h>
+#include <primitives/exceptions.h>
+#include <primitives/hash.h>
+#include <primitives/http.h>
+
+#include <cerrno>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+
+#include <primitives/log.h>
+DECLARE_STATIC_LOGGER(logger, "source.cache");
+
+namespace sw::support
+{
+
+static String get_url_hash(const String &url)
+{
+    return shorten_hash(blake2b_512(url), 16);
+}
+
+static path get_url_filename(const String &url)
+{
+    auto fn = path(url.substr(0, url.find_first_of("?#"))).filename();
+    if (fn.empty())
+        return "file";
+    return fn;
+}
+
+static String to_file_url(const path &p)
+{
+    auto s = to_string(normalize_path(p));
+#ifdef _WIN32
+    // file:///C:/dir
+    s = "/" + s;
+#endif
+    return "file://" + s;
+}
+
+// readers must not see partial results
+static void publish_dir(const path &tmp, const path &dst)
+{
+    error_code ec;
+    fs::rename(tmp, dst, ec);
+    if (!ec)
+        return;
+    // other process was faster
+    fs::remove_all(tmp, ec);
+    if (!fs::exists(dst))
+        throw SW_RUNTIME_ERROR("Cannot move " + to_string(tmp) + " to " + to_string(dst));
+}
+
+static path get_tmp_path(const path &p)
+{
+    return path(p) += "." + to_string(unique_path().u8string()) + ".tmp";
+}
+
+// copy on write clone, false if not supported
+static bool reflink(const path &from, const path &to)
+{
+    static std::atomic_bool supported = true;
+    if (!supported)
+        return false;
+#if defined(__linux__) && defined(FICLONE)
+    int src = open(from.c_str(), O_RDONLY);
+    if (src == -1)
+        return false;
+    int dst = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst == -1)
+    {
+        close(src);
+        return false;
+    }
+    bool ok = ioctl(dst, FICLONE, src) == 0;
+    if (!ok && (errno == EOPNOTSUPP || errno == EXDEV || errno == EINVAL))
+        supported = false;
+    close(src);
+    close(dst);
+    if (!ok)
+    {
+        error_code ec;
+        fs::remove(to, ec);
+    }
+    return ok;
+#elif defined(__APPLE__)
+    if (clonefile(from.c_str(), to.c_str(), 0) == 0)
+        return true;
+    if (errno == ENOTSUP || errno == EXDEV)
+        supported = false;
+    return false;
+#else
+    supported = false;
+    return false;
+#endif
+}
+
+static void copy_tree(const path &from, const path &to)
+{
+    fs::create_directories(to);
+    for (auto &e : fs::recursive_directory_iterator(from))
+    {
+        auto dst = to / e.path().lexically_relative(from);
+        if (e.is_symlink())
+            fs::copy_symlink(e.path(), dst);
+        else if (e.is_directory())
+            fs::create_directories(dst);
+        else if (reflink(e.path(), dst))
+            fs::permissions(dst, e.status().permissions());
+        else
+            fs::copy_file(e.path(), dst, fs::copy_options::overwrite_existing);
+    }
+}
+
+SourceCache::SourceCache(const path &root)
+    : root(root)
+{
+}
+
+SourceCache &SourceCache::get()
+{
+    static SourceCache c(get_root_directory() / "cache" / "sources");
+    return c;
+}
+
+std::mutex &SourceCache::getLock(const path &p)
+{
+    std::unique_lock lk(m);
+    auto &l = locks[p];
+    if (!l)
+        l = std::make_unique<std::mutex>();
+    return *l;
+}
+
+bool SourceCache::download(const Source &src, const path &dir, std::optional<std::chrono::seconds> max_age)
+{
+    try
+    {
+        // hg is derived from git, check it first
+        if (auto hg = dynamic_cast<const primitives::source::Hg *>(&src))
+            return downloadHg(*hg, dir);
+        if (auto g = dynamic_cast<const primitives::source::Git *>(&src))
+            return downloadGit(*g, dir);
+        if (auto rf = dynamic_cast<const RemoteFile *>(&src))
+            return downloadFiles(src, { rf->url }, dir, max_age);
+        if (auto rfs = dynamic_cast<const RemoteFiles *>(&src))
+            return downloadFiles(src, Strings(rfs->urls.begin(), rfs->urls.end()), dir, max_age);
+    }
+    catch (std::exception &e)
+    {
+        LOG_DEBUG(logger, "Source cache failed for " << src.print() << ": " << e.what());
+    }
+    error_code ec;
+    fs::remove_all(dir, ec);
+    return false;
+}
+
+bool SourceCache::downloadGit(const primitives::source::Git &g, const path &dir)
+{
+    auto git = primitives::resolve_executable("git");
+    if (git.empty())
+        return false;
+
+    auto repo = root / "git" / (get_url_hash(g.url) + ".git");
+    auto run = [&git, &repo](Strings args, error_code *ec = nullptr)
+    {
+        args.insert(args.begin(), { git.string(), "--git-dir", repo.string() });
+        if (ec)
+            primitives::Command::execute(args, *ec);
+        else
+            primitives::Command::execute(args);
+    };
+    auto has_rev = [&run](const String &rev)
+    {
+        error_code ec;
+        run({ "rev-parse", "--verify", "--quiet", rev + "^{commit}" }, &ec);
+        return !ec;
+    };
+
+    Strings revs;
+    if (!g.commit.empty())
+        revs.push_back(g.commit);
+    else if (!g.tag.empty())
+    {
+        revs.push_back("refs/tags/" + g.tag);
+        revs.push_back("refs/tags/v" + g.tag);
+    }
+    else if (!g.branch.empty())
+        revs.push_back("refs/heads/" + g.branch);
+    else
+        return false;
+    auto find_rev = [&revs, &has_rev]() -> String
+    {
+        for (auto &r : revs)
+        {
+            if (has_rev(r))
+                return r;
+        }
+        return {};
+    };
+
+    std::unique_lock lk(getLock(repo));
+
+    String rev;
+    if (!fs::exists(repo))
+    {
+        LOG_INFO(logger, "Cloning " << g.url << " into source cache");
+        fs::create_directories(repo.parent_path());
+        auto tmp = get_tmp_path(repo);
+        primitives::Command::execute({ git.string(), "clone", "--mirror", "--quiet", g.url, tmp.string() });
+        publish_dir(tmp, repo);
+    }
+    // branches move, so we always fetch them
+    else if (!g.branch.empty() || (rev = find_rev()).empty())
+    {
+        LOG_INFO(logger, "Fetching " << g.url << " into source cache");
+        run({ "fetch", "--prune", "--quiet", "origin" });
+        if (!g.commit.empty() && !has_rev(g.commit))
+            run({ "fetch", "--quiet", "origin", g.commit });
+    }
+    if (rev.empty())
+        rev = find_rev();
+    if (rev.empty())
+        return false;
+
+    // removed source dirs leave stale worktrees
+    run({ "worktree", "prune" });
+    run({ "worktree", "add", "--detach", "--force", dir.string(), rev + "^{commit}" });
+    lk.unlock();
+
+    if (fs::exists(dir / ".gitmodules"))
+        primitives::Command::execute({ git.string(), "-C", dir.string(), "submodule", "update", "--init", "--recursive" });
+    return true;
+}
+
+bool SourceCache::downloadHg(const primitives::source::Hg &hg, const path &dir)
+{
+    auto exe = primitives::resolve_executable("hg");
+    if (exe.empty())
+        return false;
+
+    String rev;
+    if (!hg.commit.empty())
+        rev = hg.commit;
+    else if (!hg.tag.empty())
+        rev = hg.tag;
+    else if (!hg.branch.empty())
+        rev = hg.branch;
+    else
+        return false;
+
+    auto repo = root / "hg" / get_url_hash(hg.url);
+    std::unique_lock lk(getLock(repo));
+
+    auto has_rev = [&exe, &repo, &rev]()
+    {
+        error_code ec;
+        primitives::Command::execute({ exe.string(), "-R", repo.string(), "log", "-r", rev, "--template", "." }, ec);
+        return !ec;
+    };
+
+    if (!fs::exists(repo))
+    {
+        LOG_INFO(logger, "Cloning " << hg.url << " into source cache");
+        fs::create_directories(repo.parent_path());
+        auto tmp = get_tmp_path(repo);
+        primitives::Command::execute({ exe.string(), "clone", "-U", "-q", hg.url, tmp.string() });
+        publish_dir(tmp, repo);
+    }
+    else if (!hg.branch.empty() || !has_rev())
+    {
+        LOG_INFO(logger, "Pulling " << hg.url << " into source cache");
+        primitives::Command::execute({ exe.string(), "-R", repo.string(), "pull", "-q" });
+    }
+    if (!has_rev())
+        return false;
+
+    // local clone hardlinks the store, working copy is separate
+    primitives::Command::execute({ exe.string(), "clone", "-q", "-u", rev, repo.string(), dir.string() });
+    return true;
+}
+
+path SourceCache::getObject(const String &url, std::optional<std::chrono::seconds> max_age)
+{
+    auto index = root / "urls" / get_url_hash(url);
+    std::unique_lock lk(getLock(index));
+
+    // <hash>\n<download time>
+    if (fs::exists(index))
+    {
+        auto lines = split_lines(read_file(index));
+        auto h = lines.empty() ? String{} : lines[0];
+        auto fn = root / "objects" / h / get_url_filename(url);
+        if (max_age && (lines.size() < 2 || getUtc() - string2timepoint(lines[1]) > *max_age))
+            LOG_DEBUG(logger, "Url index entry is too old, downloading again: " << url);
+        else if (!h.empty() && fs::exists(fn) && strong_file_hash_file(fn) == h)
+            return fn;
+        else
+        {
+            LOG_WARN(logger, "Bad object in source cache, downloading again: " << url);
+            error_code ec;
+            fs::remove(fn, ec);
+        }
+    }
+
+    LOG_INFO(logger, "Downloading " << url << " into source cache");
+    auto tmp = get_tmp_path(root / "objects" / get_url_hash(url));
+    download_file(url, tmp);
+    auto h = strong_file_hash_file(tmp);
+
+    // same contents from different urls are stored once
+    auto dir = root / "objects" / h;
+    auto fn = dir / get_url_filename(url);
+    fs::create_directories(dir);
+    error_code ec;
+    if (fs::exists(fn))
+        fs::remove(tmp, ec);
+    else
+    {
+        fs::rename(tmp, fn, ec);
+        if (ec)
+        {
+            fs::remove(tmp, ec);
+            if (!fs::exists(fn))
+                throw SW_RUNTIME_ERROR("Cannot store " + to_string(fn));
+        }
+    }
+
+    auto itmp = get_tmp_path(index);
+    write_file(itmp, h + "\n" + timepoint2string(getUtc()));
+    fs::rename(itmp, index);
+    return fn;
+}
+
+bool SourceCache::downloadFiles(const Source &src, const Strings &urls, const path &dir, std::optional<std::chrono::seconds> max_age)
+{
+    // same files give the same tree
+    std::map<String, path> objects;
+    for (auto &u : urls)
+    {
+        auto o = getObject(u, max_age);
+        objects.emplace(to_string(o.parent_path().filename().u8string()) + "/" + to_string(o.filename().u8string()), o);
+    }
+    String key = src.getString() + "\n";
+    for (auto &[k, _] : objects)
+        key += k + "\n";
+    auto tree = root / "trees" / shorten_hash(blake2b_512(key), 32);
+
+    {
+        std::unique_lock lk(getLock(tree));
+        if (!fs::exists(tree))
+        {
+            // unpack exactly as source does, but from the cache
+            auto tmp = get_tmp_path(tree);
+            if (objects.size() == 1 && dynamic_cast<const RemoteFile *>(&src))
+            {
+                RemoteFile rf(to_file_url(objects.begin()->second));
+                rf.download(tmp);
+            }
+            else
+            {
+                StringSet file_urls;
+                for (auto &[_, o] : objects)
+                    file_urls.insert(to_file_url(o));
+                RemoteFiles rfs(file_urls);
+                rfs.download(tmp);
+            }
+            publish_dir(tmp, tree);
+        }
+    }
+
+    copy_tree(tree, dir);
+    return true;
+}
+
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright (C) 2020 Egor Pugin <egor.pugin@gmail.com>
+
+#pragma once
+
+#include "source.h"
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace sw::support
+{
+
+/// Global cache of downloaded sources shared by all workspaces.
+///
+///  git/<url hash>.git    - bare mirrors, sources are checked out as worktrees
+///  hg/<url hash>         - repositories without working copy, local clones hardlink the store
+///  objects/<hash>/<name> - downloaded files addressed by contents hash
+///  urls/<url hash>       - url -> contents hash and download time
+///  trees/<hash>          - unpacked files, copied with reflinks when fs supports them
+///
+/// Trees are never hardlinked, because build scripts patch sources in place.
+///
+/// Urls are considered immutable: an indexed url is not downloaded again
+/// unless max_age is passed and the index entry is older.
+/// Git tags and commits are immutable too, branches are always fetched.
+struct SW_SUPPORT_API SourceCache
+{
+    SourceCache(const path &root);
+
+    /// default cache in sw root dir
+    static SourceCache &get();
+
+    /// returns false if source is not cacheable or cache failed,
+    /// then dir is removed and caller must download source itself
+    /// max_age - download urls indexed earlier again
+    bool download(const Source &, const path &dir, std::optional<std::chrono::seconds> max_age = {});
+
+private:
+    path root;
+    std::mutex m;
+    std::unordered_map<path, std::unique_ptr<std::mutex>> locks;
+
+    std::mutex &getLock(const path &);
+    bool downloadGit(const primitives::source::Git &, const path &dir);
+    bool downloadHg(const primitives::source::Hg &, const path &dir);
+    bool downloadFiles(const Source &, const Strings &urls, const path &dir, std::optional<std::chrono::seconds> max_age);
+    path getObject(const String &url, std::optional<std::chrono::seconds> max_age);
+};
+
+}
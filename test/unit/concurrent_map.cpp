@@ -0,0 +1,126 @@
+#include <sw/builder/concurrent_map.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+
+using namespace sw;
+
+// counts live values, so we can see what qsbr has not freed yet
+struct Counted
+{
+    static inline std::atomic_int64_t live = 0;
+
+    uint64_t v = 0;
+
+    Counted() { live++; }
+    Counted(const Counted &rhs) : v(rhs.v) { live++; }
+    Counted &operator=(const Counted &) = default;
+    ~Counted() { live--; }
+};
+
+static const int n_threads = 8;
+static const int n_keys = 1000;
+static const int n_rounds = 1000;
+
+// all threads insert the same keys, so there are many insert races
+template <class F>
+static void run_round(ConcurrentMap<uint64_t, Counted> &m, F &&in_context)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++)
+    {
+        threads.emplace_back([&m, &in_context, t]
+        {
+            in_context([&m, t]
+            {
+                for (uint64_t k = 1; k <= n_keys; k++)
+                {
+                    auto v = m.insert((k * (t + 1)) % n_keys + 1).first;
+                    v->v = k;
+                }
+            });
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+}
+
+// retired values of round i are freed during round i + 1 or i + 2,
+// so live values must stay below a few rounds worth of them
+template <class F>
+static void check_steady_state(F &&in_context)
+{
+    ConcurrentMap<uint64_t, Counted> m;
+    auto bound = 3 * n_keys * n_threads;
+    int64_t max_live = 0;
+    for (int i = 0; i < n_rounds; i++)
+    {
+        run_round(m, in_context);
+        REQUIRE(Counted::live <= bound);
+        if (i == n_rounds / 10)
+            max_live = Counted::live;
+        // not thread safe, all threads left
+        m.clear();
+    }
+    // no growth after warm up
+    CHECK(Counted::live <= max_live + n_keys * n_threads);
+}
+
+TEST_CASE("Checking concurrent map memory", "[concurrent_map]")
+{
+    SECTION("Scoped contexts")
+    {
+        check_steady_state([](auto &&f)
+        {
+            ScopedConcurrentContext ctx;
+            f();
+        });
+    }
+
+    SECTION("Nested scoped contexts")
+    {
+        check_steady_state([](auto &&f)
+        {
+            ScopedConcurrentContext ctx;
+            ScopedConcurrentContext ctx2;
+            f();
+        });
+    }
+
+    SECTION("Context batch")
+    {
+        // batch lives for a round like it lives for a plan run
+        ConcurrentMap<uint64_t, Counted> m;
+        auto bound = 3 * n_keys * n_threads;
+        for (int i = 0; i < n_rounds; i++)
+        {
+            {
+                ConcurrentContextBatch qsbr(16);
+                run_round(m, [&qsbr](auto &&f)
+                {
+                    // many short tasks per thread
+                    for (int j = 0; j < 4; j++)
+                    {
+                        qsbr.enter();
+                        f();
+                        qsbr.leave();
+                    }
+                });
+            }
+            REQUIRE(Counted::live <= bound);
+            m.clear();
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Catch::Session().run(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <sw/manager/package_database.h>
+
+#include <sqlpp11/sqlite3/connection.h>
+
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+
+using namespace sw;
+
+static std::vector<String> get_all_pages(const PackagesDatabase &db, const String &name, int limit)
+{
+    std::vector<String> r;
+    for (int offset = 0;; offset += limit)
+    {
+        auto page = db.getMatchingPackages(name, limit, offset);
+        if (page.empty())
+            break;
+        for (auto &p : page)
+            r.push_back(p.toString());
+    }
+    return r;
+}
+
+TEST_CASE("Checking package search paging", "[database]")
+{
+    auto fn = fs::temp_directory_path() / unique_path() += ".sqlite";
+    {
+        PackagesDatabase db(fn);
+        for (auto &p : {
+            // element boundary matches of 'boo'
+            "org.sw.demo.boost.asio",
+            "org.sw.demo.boost.beast",
+            "pub.boo.x",
+            // substring matches only
+            "org.sw.demo.facebook.folly",
+            "org.sw.demo.facebook.zstd",
+            "org.sw.demo.ebook.a",
+            "org.sw.demo.ebook.b",
+            "org.sw.demo.ebook.c",
+            "org.sw.demo.ebook.d",
+            "org.sw.demo.ebook.e",
+            })
+        {
+            db.db->execute("INSERT INTO package (path) VALUES ('" + String(p) + "')");
+        }
+        db.updateSearchIndex();
+
+        SECTION("Boundary matches")
+        {
+            auto all = get_all_pages(db, "boo", 1000);
+            REQUIRE(all.size() == 3);
+            // pages are parts of the unpaged result
+            CHECK(get_all_pages(db, "boo", 2) == all);
+            CHECK(get_all_pages(db, "boo", 1) == all);
+            // past the end there is nothing, not substring matches
+            CHECK(db.getMatchingPackages("boo", 2, 4).empty());
+            CHECK(db.getMatchingPackages("boo", 2, 100).empty());
+        }
+
+        SECTION("Substring fallback")
+        {
+            auto all = get_all_pages(db, "book", 1000);
+            REQUIRE(all.size() == 7);
+            CHECK(get_all_pages(db, "book", 3) == all);
+            CHECK(db.getMatchingPackages("book", 3, 7).empty());
+        }
+    }
+    fs::remove(fn);
+}
+
+int main(int argc, char **argv)
+{
+    Catch::Session().run(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <sw/builder/deps_parser.h>
+
+#include <random>
+#include <vector>
+
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+
+using namespace sw;
+
+static std::vector<std::string> parse_gnu(const std::string &s)
+{
+    std::vector<std::string> v;
+    parse_deps_gnu(s, [&v](std::string_view f) { v.emplace_back(f); });
+    return v;
+}
+
+TEST_CASE("Checking gnu deps", "[deps]")
+{
+    SECTION("Simple")
+    {
+        auto v = parse_gnu("file.o: dep1.cpp dep2.cpp \\\n  dep1.h dep2.h \\\n dep3.h\n");
+        REQUIRE(v == std::vector<std::string>{ "dep1.cpp", "dep2.cpp", "dep1.h", "dep2.h", "dep3.h" });
+    }
+
+    SECTION("Escapes")
+    {
+        auto v = parse_gnu("file.o: a\\ b.cpp c\\#d.h e$$f.h \\\r\n g.h\\\n h.h");
+        REQUIRE(v == std::vector<std::string>{ "a b.cpp", "c#d.h", "e$f.h", "g.h", "h.h" });
+    }
+
+    SECTION("Windows")
+    {
+        auto v = parse_gnu("C:/x/file.o: C:/x/file.cpp C:\\x\\y.h");
+        REQUIRE(v == std::vector<std::string>{ "C:/x/file.cpp", "C:\\x\\y.h" });
+    }
+
+    SECTION("Continuation without space")
+    {
+        auto v = parse_gnu("file.o: a.cpp b.h\\\nc.h \\\r\nd.h\\");
+        REQUIRE(v == std::vector<std::string>{ "a.cpp", "b.h", "c.h", "d.h" });
+    }
+
+    SECTION("First rule only")
+    {
+        auto v = parse_gnu("file.o: a.cpp \\\n b.h\nfile.gcm: c.h\n");
+        REQUIRE(v == std::vector<std::string>{ "a.cpp", "b.h" });
+    }
+
+    SECTION("No deps")
+    {
+        REQUIRE(parse_gnu("").empty());
+        REQUIRE(parse_gnu("file.o:\n").empty());
+        REQUIRE(parse_gnu("file.o: \\\n").empty());
+    }
+
+    SECTION("Fuzz")
+    {
+        // escape random names and read them back
+        std::mt19937 rng(1);
+        const std::string alpha = "ab/.# $_-\\";
+        for (int i = 0; i < 10000; i++)
+        {
+            std::vector<std::string> names;
+            std::string s = "file.o:";
+            auto n = rng() % 5;
+            for (size_t j = 0; j < n; j++)
+            {
+                std::string name, escaped;
+                auto l = 1 + rng() % 8;
+                for (size_t k = 0; k < l; k++)
+                    name += alpha[rng() % alpha.size()];
+                // backslash at the end or before escaped chars is ambiguous
+                if (name.back() == '\\' || name.find("\\ ") != name.npos || name.find("\\#") != name.npos)
+                    continue;
+                for (auto c : name)
+                {
+                    if (c == ' ' || c == '#')
+                        escaped += '\\';
+                    else if (c == '$')
+                        escaped += '$';
+                    escaped += c;
+                }
+                names.push_back(name);
+                s += (rng() % 2 ? " \\\n " : " ") + escaped;
+            }
+            REQUIRE(parse_gnu(s) == names);
+
+            // garbage must not crash
+            std::string g;
+            auto gl = rng() % 64;
+            for (size_t k = 0; k < gl; k++)
+                g += (char)(rng() % 256);
+            parse_gnu(g);
+        }
+    }
+}
+
+TEST_CASE("Checking msvc deps", "[deps]")
+{
+    std::string text = "file.cpp\nNote: including file: a.h \r\nerror\nNote: including file:  b.h\nlast";
+    std::vector<std::string> v;
+    parse_deps_msvc(text, "Note: including file:", true, [&v](std::string_view f) { v.emplace_back(f); });
+    REQUIRE(v == std::vector<std::string>{ "a.h", "b.h" });
+    REQUIRE(text == "error\nlast");
+}
+
+int main(int argc, char **argv)
+{
+    Catch::Session().run(argc, argv);
+
+    return 0;
+}
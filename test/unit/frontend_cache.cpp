@@ -0,0 +1,116 @@
+#include <sw/driver/frontend/cache.h>
+#include <sw/driver/frontend/cmake/cmake_fe.h>
+
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+
+using namespace sw;
+using namespace sw::driver::cpp::frontend;
+
+TEST_CASE("Checking frontend cache", "[frontend_cache]")
+{
+    auto root = fs::temp_directory_path() / unique_path();
+    auto src = root / "src";
+    fs::create_directories(src);
+    FrontendCache c(root / "cache");
+
+    auto list = src / "CMakeLists.txt";
+    auto out = src / "config.h";
+    write_file(list, "project(x)");
+    write_file(out, "");
+    write_file(src / "a.cpp", "");
+
+    nlohmann::json result = { {"name", "x"} };
+
+    SECTION("Miss on empty cache")
+    {
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("Hit")
+    {
+        c.save("k", { list }, { out }, result);
+        CHECK(c.load("k") == result);
+        CHECK(c.load("k2").is_null());
+    }
+
+    SECTION("Read file changed")
+    {
+        c.save("k", { list }, { out }, result);
+        write_file(list, "project(y)");
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("Output removed")
+    {
+        c.save("k", { list }, { out }, result);
+        fs::remove(out);
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("Output changed")
+    {
+        // other settings configured into the same dir
+        c.save("k", { list }, { out }, result);
+        write_file(out, "#define X 1");
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("file(READ) input changed")
+    {
+        auto version = src / "version.h";
+        write_file(version, "#define VERSION 1");
+        auto inputs = sw::driver::cpp::CmakeTargetEntryPoint::getFileCommandInputs({ "READ", "version.h", "V" }, src);
+        REQUIRE(inputs.size() == 1);
+        CHECK(*inputs.begin() == (src / "version.h").lexically_normal());
+        CHECK(sw::driver::cpp::CmakeTargetEntryPoint::getFileCommandInputs({ "WRITE", "version.h", "V" }, src).empty());
+
+        auto files = inputs;
+        files.insert(list);
+        c.save("k", files, {}, result);
+        CHECK(c.load("k") == result);
+
+        write_file(version, "#define VERSION 2");
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("Glob changed")
+    {
+        Probes probes;
+        GlobProbe g;
+        g.expression = to_string(normalize_path(src)) + "/*.cpp";
+        g.files = g.run();
+        REQUIRE(g.files.size() == 1);
+        probes.globs.push_back(g);
+        c.save("k", { list }, {}, result, probes);
+        CHECK(c.load("k") == result);
+
+        // unrelated file
+        write_file(src / "b.h", "");
+        CHECK(c.load("k") == result);
+
+        write_file(src / "b.cpp", "");
+        CHECK(c.load("k").is_null());
+    }
+
+    SECTION("Existence changed")
+    {
+        Probes probes;
+        auto f = src / "optional.cmake";
+        probes.exists[to_string(normalize_path(f))] = false;
+        c.save("k", { list }, {}, result, probes);
+        CHECK(c.load("k") == result);
+
+        write_file(f, "");
+        CHECK(c.load("k").is_null());
+    }
+
+    fs::remove_all(root);
+}
+
+int main(int argc, char **argv)
+{
+    Catch::Session().run(argc, argv);
+
+    return 0;
+}